@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "event_manager.h"
+#include "events_table.h"
+#include "event_bridge.h"
+#include "bridge_loopback.h"
+
+// this process plays both nodes: events produced here (node 1) are forwarded through a TCP and
+// a unix socket link and re-injected by the servers (node 2), so every event of the shared group
+// reaches its modules once directly and once more through each link (with origin 1)
+#define LOOPBACK_LOCAL_NODE             1
+#define LOOPBACK_REMOTE_NODE            2
+
+#define LOOPBACK_TCP_ADDRESS            "127.0.0.1"
+#define LOOPBACK_TCP_PORT               47000
+#define LOOPBACK_UNIX_PATH              "/tmp/event_bridge_loopback.sock"
+
+// links / servers of each transport
+#define LOOPBACK_TRANSPORTS             2
+
+// event groups shared through the bridge
+#define LOOPBACK_SHARED_GROUPS          1
+
+static events_group_t       shared_group_list[ LOOPBACK_SHARED_GROUPS ] = {
+    events_group_3
+};
+
+// links configuration, a link is a module like any other (unique module_id)
+static bridge_link_config_t link_config_table[ LOOPBACK_TRANSPORTS ] = {
+    {
+        .node_id = LOOPBACK_LOCAL_NODE, .module_id = 10,
+        .max_groups = LOOPBACK_SHARED_GROUPS, .groups = shared_group_list,
+        .transport = bridge_tcp, .address = LOOPBACK_TCP_ADDRESS, .port = LOOPBACK_TCP_PORT,
+        .flush_milliseconds = 5, .reconnect_milliseconds = 250
+    },
+    {
+        .node_id = LOOPBACK_LOCAL_NODE, .module_id = 11,
+        .max_groups = LOOPBACK_SHARED_GROUPS, .groups = shared_group_list,
+        .transport = bridge_unix, .address = LOOPBACK_UNIX_PATH, .port = 0,
+        .flush_milliseconds = 5, .reconnect_milliseconds = 250
+    }
+};
+
+// servers configuration, only shared groups are accepted
+static bridge_server_config_t server_config_table[ LOOPBACK_TRANSPORTS ] = {
+    {
+        .node_id = LOOPBACK_REMOTE_NODE,
+        .max_groups = LOOPBACK_SHARED_GROUPS, .groups = shared_group_list,
+        .transport = bridge_tcp, .address = LOOPBACK_TCP_ADDRESS, .port = LOOPBACK_TCP_PORT
+    },
+    {
+        .node_id = LOOPBACK_REMOTE_NODE,
+        .max_groups = LOOPBACK_SHARED_GROUPS, .groups = shared_group_list,
+        .transport = bridge_unix, .address = LOOPBACK_UNIX_PATH, .port = 0
+    }
+};
+
+static const char           *transport_names[ LOOPBACK_TRANSPORTS ] = { "tcp ", "unix" };
+
+static bridge_link_t        *links[ LOOPBACK_TRANSPORTS ];
+static bridge_server_t      *servers[ LOOPBACK_TRANSPORTS ];
+
+// start bridge servers
+static void start_bridge_loopback_servers()
+{
+    int i;
+
+    for( i = 0; i < LOOPBACK_TRANSPORTS; i++ ) {
+        servers[ i ] = bridge_server_start( &server_config_table[ i ] );
+        if( servers[ i ] == NULL ) {
+            printf( "[ LOOP  ] Error. Can't start %s bridge server\n", transport_names[ i ] );
+        }
+    }
+}
+
+// stop bridge servers
+static void stop_bridge_loopback_servers()
+{
+    int i;
+
+    for( i = 0; i < LOOPBACK_TRANSPORTS; i++ ) {
+        if( servers[ i ] != NULL ) {
+            bridge_server_stop( servers[ i ] );
+            servers[ i ] = NULL;
+        }
+    }
+}
+
+// initialization of bridge loopback (links and servers of events_group_3 inside this process)
+void initialize_bridge_loopback()
+{
+    int i;
+
+    // links are started first, they keep trying to connect until servers are up
+    for( i = 0; i < LOOPBACK_TRANSPORTS; i++ ) {
+        links[ i ] = bridge_link_start( &link_config_table[ i ] );
+        if( links[ i ] == NULL ) {
+            printf( "[ LOOP  ] Error. Can't start %s bridge link\n", transport_names[ i ] );
+        }
+    }
+
+    start_bridge_loopback_servers();
+}
+
+// stop and start again bridge servers, links reconnect by themselves
+void restart_bridge_loopback_servers()
+{
+    printf( "[ LOOP  ] Restarting bridge servers\n" );
+
+    stop_bridge_loopback_servers();
+    start_bridge_loopback_servers();
+}
+
+// wait links termination after sending special event ev_terminate_thread, print counters and stop servers
+void terminate_bridge_loopback()
+{
+    bridge_stats_t  stats;
+    int i;
+
+    for( i = 0; i < LOOPBACK_TRANSPORTS; i++ ) {
+        if( links[ i ] != NULL ) {
+            bridge_link_get_stats( links[ i ], &stats );
+            printf( "[ LOOP  ] %s link   -> frames %llu events %llu bytes %llu dropped %llu connections %llu\n",
+                    transport_names[ i ],
+                    ( unsigned long long ) stats.frames, ( unsigned long long ) stats.events, ( unsigned long long ) stats.bytes,
+                    ( unsigned long long ) stats.dropped, ( unsigned long long ) stats.connections );
+            bridge_link_stop( links[ i ] );
+            links[ i ] = NULL;
+        }
+    }
+
+    for( i = 0; i < LOOPBACK_TRANSPORTS; i++ ) {
+        if( servers[ i ] != NULL ) {
+            bridge_server_get_stats( servers[ i ], &stats );
+            printf( "[ LOOP  ] %s server -> frames %llu events %llu bytes %llu dropped %llu connections %llu\n",
+                    transport_names[ i ],
+                    ( unsigned long long ) stats.frames, ( unsigned long long ) stats.events, ( unsigned long long ) stats.bytes,
+                    ( unsigned long long ) stats.dropped, ( unsigned long long ) stats.connections );
+        }
+    }
+
+    stop_bridge_loopback_servers();
+}
@@ -0,0 +1,13 @@
+#ifndef __BRIDGE_LOOPBACK_H__
+#define __BRIDGE_LOOPBACK_H__
+
+// initialization of bridge loopback (links and servers of events_group_3 inside this process)
+void initialize_bridge_loopback();
+
+// stop and start again bridge servers, links reconnect by themselves
+void restart_bridge_loopback_servers();
+
+// wait links termination after sending special event ev_terminate_thread, print counters and stop servers
+void terminate_bridge_loopback();
+
+#endif
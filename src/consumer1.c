@@ -20,11 +20,39 @@ static events_group_t       event_group_list[ CONSUMER1_EVENT_GROUPS ] = {
     events_group_threads
 };
 
+// ------------------- resumable tasks (start) ---------------------------------
+
+// event1 starts an exchange that goes on when event2 follows, without blocking the thread
+static event_task_t         exchange_task;
+
+static int exchange_task_fn( event_task_t *task, void *ctx )
+{
+    ( void ) ctx;
+
+    EVENT_TASK_BEGIN( task );
+
+    printf( "[ CONS1 ] exchange task waiting for event2...\n" );
+    EVENT_TASK_AWAIT( task, ev_event2, 0, 0, 2000 );
+
+    if( task->event_object.id == EVENT_TASK_TIMEOUT ) {
+        printf( "[ CONS1 ] exchange task timed out\n" );
+    } else if( task->event_object.id == EVENT_TASK_FAILED ) {
+        printf( "[ CONS1 ] exchange task can't wait for event2\n" );
+    } else {
+        printf( "[ CONS1 ] exchange task resumed by event2, event data %d\n", task->event_object.data );
+    }
+
+    EVENT_TASK_END( task );
+}
+
+// ------------------- resumable tasks (end) ---------------------------------
+
 // ------------------- event handlers (start) ---------------------------------
 
 static void event1_handler( event_object_t event_object )
 {
     printf( "[ CONS1 ] event1 handler, event data %d\n", event_object.data );
+    event_task_start( &exchange_task, exchange_task_fn, NULL );
 }
 
 static void event2_handler( event_object_t event_object )
@@ -65,6 +93,8 @@ void initialize_consumer1()
     thread_ctrl->handlers               = (handler_t*)&event_handlers_table;
     thread_ctrl->timedwait_milliseconds = 0;
     thread_ctrl->timed_ops              = NULL;
+    thread_ctrl->max_event_filters      = 0;
+    thread_ctrl->filters                = NULL;
 
     // create a thread waiting for events and set it up through thread_ctrl structure
     pthread_create( &thread_id, NULL, event_processing_thread, ( void* )( thread_ctrl ) );
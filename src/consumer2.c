@@ -41,6 +41,18 @@ static handler_t event_handlers_table[ CONSUMER2_EVENT_HANDLERS ] = {
     {  ev_event4,               event4_handler              }
 };
 
+// this table restricts by content the events delivered to this module
+// consumer 2 is only interested in event4 for a few instruments (data values)
+#define CONSUMER2_EVENT4_INSTRUMENTS    3
+
+static uint32_t event4_instruments[ CONSUMER2_EVENT4_INSTRUMENTS ] = { 30, 10, 20 };
+
+#define CONSUMER2_EVENT_FILTERS         1
+
+static event_filter_t event_filters_table[ CONSUMER2_EVENT_FILTERS ] = {
+    {  .event_id = ev_event4,   .type = filter_set,     .values = event4_instruments,   .max_values = CONSUMER2_EVENT4_INSTRUMENTS  }
+};
+
 // initialization of consumer 2
 void initialize_consumer2()
 {
@@ -52,6 +64,8 @@ void initialize_consumer2()
     thread_ctrl->handlers               = (handler_t*)&event_handlers_table;
     thread_ctrl->timedwait_milliseconds = 0;
     thread_ctrl->timed_ops              = NULL;
+    thread_ctrl->max_event_filters      = CONSUMER2_EVENT_FILTERS;
+    thread_ctrl->filters                = (event_filter_t*)&event_filters_table;
 
     // create a thread waiting for events and set it up through thread_ctrl structure
     pthread_create( &thread_id, NULL, event_processing_thread, ( void* )( thread_ctrl ) );
@@ -63,5 +77,9 @@ void terminate_consumer2()
     if( thread_id != 0 ) {
         pthread_join( thread_id, NULL );
     }
+
+#ifdef EVENT_MANAGER_DEBUG
+    debug_event_filters( thread_ctrl );
+#endif
 }
 
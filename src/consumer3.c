@@ -59,6 +59,8 @@ void initialize_consumer3()
     thread_ctrl->handlers               = (handler_t*)&event_handlers_table;
     thread_ctrl->timedwait_milliseconds = 200;
     thread_ctrl->timed_ops              = consumer3_timed_operations;
+    thread_ctrl->max_event_filters      = 0;
+    thread_ctrl->filters                = NULL;
 
     // create a thread waiting for events and set it up through thread_ctrl structure
     pthread_create( &thread_id, NULL, event_processing_thread, ( void* )( thread_ctrl ) );
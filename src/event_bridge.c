@@ -0,0 +1,702 @@
+/**
+ * Copyright 2024 Daniele Brunello daniele.brunello.dev@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "event_manager.h"
+#include "events_table.h"
+#include "event_bridge.h"
+
+// biggest frame a link can send
+#define BRIDGE_FRAME_MAX_SIZE           ( BRIDGE_FRAME_HEADER_SIZE + BRIDGE_BATCH_EVENTS * BRIDGE_FRAME_EVENT_SIZE )
+
+// link reconnection period when reconnect_milliseconds is not set
+#define BRIDGE_RECONNECT_MILLISECONDS   1000
+
+// server poll timeout and max wait for credits when re-injecting an event
+#define BRIDGE_SERVER_POLL_MILLISECONDS 100
+
+// outbound link data
+struct bridge_link {
+    bridge_link_config_t    config;
+    thread_ctrl_t           thread_ctrl;                            // link's event processing thread configuration
+    events_group_t          groups[ events_group_max + 1 ];         // forwarded groups + events_group_threads
+    handler_t               handlers[ ev_max ];                     // forwarding handler for each forwarded event
+    pthread_t               thread_id;
+    int                     fd;                                     // socket (-1 = disconnected)
+    int64_t                 next_connect;                           // time of next connection attempt
+    int64_t                 batch_started;                          // time first event was added to batch
+    uint32_t                batch_events;                           // events in batch
+    uint8_t                 batch[ BRIDGE_FRAME_MAX_SIZE ];         // frame being collected
+    bridge_stats_t          stats;
+};
+
+// inbound connection data
+typedef struct {
+    int                     fd;
+    uint32_t                length;                                 // bytes received and not yet parsed
+    uint8_t                 buffer[ BRIDGE_FRAME_MAX_SIZE ];
+} bridge_connection_t;
+
+// inbound server data
+struct bridge_server {
+    bridge_server_config_t  config;
+    pthread_t               thread_id;
+    int                     running;
+    int                     fd;                                     // listening socket
+    uint32_t                max_connections;
+    bridge_connection_t     connections[ BRIDGE_MAX_CONNECTIONS ];
+    int                     accepted[ events_group_max ];           // groups re-injected by this server
+    bridge_stats_t          stats;
+};
+
+// link served by the calling thread (handlers and timed_ops have no context argument)
+static __thread bridge_link_t   *current_link;
+
+// monotonic time in milliseconds, bridges work on real sockets whatever event manager time source is
+static int64_t bridge_millis()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( int64_t ) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// counters are written by bridge's thread and read by anyone
+static void bridge_count( uint64_t *counter, uint64_t value )
+{
+    __atomic_fetch_add( counter, value, __ATOMIC_RELAXED );
+}
+
+static void bridge_read_stats( bridge_stats_t *src, bridge_stats_t *stats )
+{
+    stats->frames       = __atomic_load_n( &src->frames, __ATOMIC_RELAXED );
+    stats->events       = __atomic_load_n( &src->events, __ATOMIC_RELAXED );
+    stats->bytes        = __atomic_load_n( &src->bytes, __ATOMIC_RELAXED );
+    stats->dropped      = __atomic_load_n( &src->dropped, __ATOMIC_RELAXED );
+    stats->connections  = __atomic_load_n( &src->connections, __ATOMIC_RELAXED );
+}
+
+// ------------------- framing (start) ---------------------------------
+
+static void put_u16( uint8_t *p, uint16_t value )
+{
+    p[ 0 ] = ( uint8_t )( value >> 8 );
+    p[ 1 ] = ( uint8_t )( value );
+}
+
+static void put_u32( uint8_t *p, uint32_t value )
+{
+    put_u16( p, ( uint16_t )( value >> 16 ) );
+    put_u16( p + 2, ( uint16_t )( value ) );
+}
+
+static void put_u64( uint8_t *p, uint64_t value )
+{
+    put_u32( p, ( uint32_t )( value >> 32 ) );
+    put_u32( p + 4, ( uint32_t )( value ) );
+}
+
+static uint16_t get_u16( const uint8_t *p )
+{
+    return ( uint16_t )( ( p[ 0 ] << 8 ) | p[ 1 ] );
+}
+
+static uint32_t get_u32( const uint8_t *p )
+{
+    return ( ( uint32_t ) get_u16( p ) << 16 ) | get_u16( p + 2 );
+}
+
+// ------------------- framing (end) ---------------------------------
+
+// ------------------- sockets (start) ---------------------------------
+
+// fill socket address for transport, return address length (0 on error)
+static socklen_t bridge_address( bridge_transport_t transport, const char *address, uint16_t port, struct sockaddr_storage *storage )
+{
+    struct sockaddr_in  *in = ( struct sockaddr_in * ) storage;
+    struct sockaddr_un  *un = ( struct sockaddr_un * ) storage;
+
+    memset( storage, 0, sizeof( *storage ) );
+
+    if( transport == bridge_unix ) {
+        if( strlen( address ) >= sizeof( un->sun_path ) ) {
+            return 0;
+        }
+        un->sun_family = AF_UNIX;
+        strcpy( un->sun_path, address );
+        return sizeof( struct sockaddr_un );
+    }
+
+    in->sin_family = AF_INET;
+    in->sin_port = htons( port );
+    if( inet_pton( AF_INET, address, &in->sin_addr ) != 1 ) {
+        return 0;
+    }
+    return sizeof( struct sockaddr_in );
+}
+
+// open a socket connected to remote node (-1 on error), connect and every send wait at most timeout_milliseconds
+static int bridge_connect( bridge_transport_t transport, const char *address, uint16_t port, int32_t timeout_milliseconds )
+{
+    struct sockaddr_storage storage;
+    struct pollfd           fds;
+    struct timeval          tv;
+    socklen_t               length;
+    int                     fd;
+    int                     flags;
+    int                     error = 0;
+    int                     on = 1;
+
+    length = bridge_address( transport, address, port, &storage );
+    if( length == 0 ) {
+        return -1;
+    }
+
+    fd = socket( storage.ss_family, SOCK_STREAM, 0 );
+    if( fd < 0 ) {
+        return -1;
+    }
+
+    // events are already batched, don't let Nagle delay frames
+    if( transport == bridge_tcp ) {
+        setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on ) );
+    }
+
+    // a blocking connect to an unreachable host would stall link's thread for the kernel timeout
+    flags = fcntl( fd, F_GETFL, 0 );
+    fcntl( fd, F_SETFL, flags | O_NONBLOCK );
+    if( connect( fd, ( struct sockaddr * ) &storage, length ) != 0 ) {
+        fds.fd = fd;
+        fds.events = POLLOUT;
+        fds.revents = 0;
+        length = sizeof( error );
+        if( ( errno != EINPROGRESS ) || ( poll( &fds, 1, timeout_milliseconds ) <= 0 ) ||
+            ( getsockopt( fd, SOL_SOCKET, SO_ERROR, &error, &length ) != 0 ) || ( error != 0 ) ) {
+            close( fd );
+            return -1;
+        }
+    }
+    fcntl( fd, F_SETFL, flags );
+
+    // a stuck remote node makes send fail (and the link reconnect) instead of blocking link's thread
+    tv.tv_sec = timeout_milliseconds / 1000;
+    tv.tv_usec = ( timeout_milliseconds % 1000 ) * 1000;
+    setsockopt( fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof( tv ) );
+
+    return fd;
+}
+
+// open listening socket (-1 on error)
+static int bridge_listen( bridge_transport_t transport, const char *address, uint16_t port )
+{
+    struct sockaddr_storage storage;
+    socklen_t               length;
+    int                     fd;
+    int                     on = 1;
+
+    length = bridge_address( transport, address, port, &storage );
+    if( length == 0 ) {
+        return -1;
+    }
+
+    fd = socket( storage.ss_family, SOCK_STREAM, 0 );
+    if( fd < 0 ) {
+        return -1;
+    }
+
+    if( transport == bridge_unix ) {
+        unlink( address );
+    } else {
+        setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on ) );
+    }
+
+    if( ( bind( fd, ( struct sockaddr * ) &storage, length ) != 0 ) || ( listen( fd, BRIDGE_MAX_CONNECTIONS ) != 0 ) ) {
+        close( fd );
+        return -1;
+    }
+
+    return fd;
+}
+
+// write whole buffer, return 0 if connection is lost
+static int bridge_send_all( int fd, const uint8_t *buffer, uint32_t length )
+{
+    ssize_t sent;
+
+    while( length > 0 ) {
+        sent = send( fd, buffer, length, MSG_NOSIGNAL );
+        if( sent < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            return 0;
+        }
+        buffer += sent;
+        length -= ( uint32_t ) sent;
+    }
+
+    return 1;
+}
+
+// ------------------- sockets (end) ---------------------------------
+
+// ------------------- outbound link (start) ---------------------------------
+
+// connect link if disconnected and a new attempt is due
+static void bridge_link_connect( bridge_link_t *link, int64_t now )
+{
+    struct pollfd   fds;
+
+    // servers never send anything, a readable socket means the link was closed on the other side
+    if( link->fd >= 0 ) {
+        fds.fd = link->fd;
+        fds.events = POLLIN;
+        fds.revents = 0;
+        if( poll( &fds, 1, 0 ) <= 0 ) {
+            return;
+        }
+        close( link->fd );
+        link->fd = -1;
+#ifdef EVENT_MANAGER_DEBUG
+        printf( "[ BRDG  ] Node %d link closed by remote node\n", link->config.node_id );
+#endif
+    }
+
+    if( now < link->next_connect ) {
+        return;
+    }
+
+    link->next_connect = now + link->config.reconnect_milliseconds;
+    link->fd = bridge_connect( link->config.transport, link->config.address, link->config.port, link->config.reconnect_milliseconds );
+    if( link->fd >= 0 ) {
+        bridge_count( &link->stats.connections, 1 );
+#ifdef EVENT_MANAGER_DEBUG
+        printf( "[ BRDG  ] Node %d link connected to %s:%d\n", link->config.node_id, link->config.address, link->config.port );
+#endif
+    }
+}
+
+// send collected events as a single frame
+static void bridge_link_flush( bridge_link_t *link, int64_t now )
+{
+    uint32_t length;
+
+    if( link->batch_events == 0 ) {
+        return;
+    }
+
+    bridge_link_connect( link, now );
+    if( link->fd < 0 ) {
+        return;
+    }
+
+    put_u16( link->batch, BRIDGE_FRAME_MAGIC );
+    link->batch[ 2 ] = BRIDGE_FRAME_VERSION;
+    link->batch[ 3 ] = 0;
+    put_u32( link->batch + 4, link->config.node_id );
+    put_u16( link->batch + 8, ( uint16_t ) link->batch_events );
+    put_u16( link->batch + 10, 0 );
+    length = BRIDGE_FRAME_HEADER_SIZE + link->batch_events * BRIDGE_FRAME_EVENT_SIZE;
+
+    if( !bridge_send_all( link->fd, link->batch, length ) ) {
+        // keep the batch, it will be sent again after reconnection
+        close( link->fd );
+        link->fd = -1;
+#ifdef EVENT_MANAGER_DEBUG
+        printf( "[ BRDG  ] Node %d link lost\n", link->config.node_id );
+#endif
+        return;
+    }
+
+    bridge_count( &link->stats.frames, 1 );
+    bridge_count( &link->stats.events, link->batch_events );
+    bridge_count( &link->stats.bytes, length );
+    link->batch_events = 0;
+}
+
+// wake up link's thread after flush_milliseconds only while a batch is waiting to be sent,
+// otherwise every reconnect_milliseconds to keep the link up
+static void bridge_link_schedule( bridge_link_t *link )
+{
+    if( ( link->batch_events > 0 ) && ( link->fd >= 0 ) ) {
+        link->thread_ctrl.timedwait_milliseconds = link->config.flush_milliseconds;
+    } else {
+        link->thread_ctrl.timedwait_milliseconds = link->config.reconnect_milliseconds;
+    }
+}
+
+// handler of every forwarded event: add it to the batch
+static void bridge_forward_handler( event_object_t event_object )
+{
+    bridge_link_t   *link = current_link;
+    uint8_t         *p;
+    int64_t         now = bridge_millis();
+
+    // events received from other nodes are never forwarded again (loop prevention)
+    if( event_object.origin != 0 ) {
+        return;
+    }
+
+    if( link->batch_events == BRIDGE_BATCH_EVENTS ) {
+        bridge_link_flush( link, now );
+        if( link->batch_events == BRIDGE_BATCH_EVENTS ) {
+            bridge_count( &link->stats.dropped, 1 );
+            return;
+        }
+    }
+
+    if( link->batch_events == 0 ) {
+        link->batch_started = now;
+    }
+
+    p = link->batch + BRIDGE_FRAME_HEADER_SIZE + link->batch_events * BRIDGE_FRAME_EVENT_SIZE;
+    put_u32( p, ( uint32_t ) event_object.id );
+    put_u32( p + 4, event_object.data );
+    put_u64( p + 8, event_object.timestamp );
+    link->batch_events++;
+
+    if( link->batch_events == BRIDGE_BATCH_EVENTS ) {
+        bridge_link_flush( link, now );
+    }
+
+    bridge_link_schedule( link );
+}
+
+// called by link's thread after every event and every flush_milliseconds / reconnect_milliseconds
+static void bridge_link_timed_operations( void )
+{
+    bridge_link_t   *link = current_link;
+    int64_t         now = bridge_millis();
+
+    // keep the link up even when there is nothing to send
+    bridge_link_connect( link, now );
+
+    if( ( link->batch_events > 0 ) && ( now - link->batch_started >= link->config.flush_milliseconds ) ) {
+        bridge_link_flush( link, now );
+    }
+
+    bridge_link_schedule( link );
+}
+
+// link's thread: base event processing thread serving this link
+static void* bridge_link_thread( void *arg )
+{
+    current_link = ( bridge_link_t * ) arg;
+
+    return event_processing_thread( &current_link->thread_ctrl );
+}
+
+// start forwarding selected groups to a remote node, NULL on error
+bridge_link_t* bridge_link_start( bridge_link_config_t *config )
+{
+    bridge_link_t   *link;
+    uint32_t        i;
+    int             event_id;
+    int             forwarded;
+
+    if( ( config->node_id == 0 ) || ( config->max_groups > events_group_max ) ) {
+        return NULL;
+    }
+
+    link = ( bridge_link_t * ) calloc( 1, sizeof( bridge_link_t ) );
+    if( link == NULL ) {
+        return NULL;
+    }
+
+    link->config = *config;
+    if( link->config.flush_milliseconds <= 0 ) {
+        link->config.flush_milliseconds = 1;
+    }
+    if( link->config.reconnect_milliseconds <= 0 ) {
+        link->config.reconnect_milliseconds = BRIDGE_RECONNECT_MILLISECONDS;
+    }
+    link->fd = -1;
+
+    // forwarding handler for every event of forwarded groups (thread control events excluded)
+    for( event_id = 0; event_id < ev_max; event_id++ ) {
+        forwarded = 0;
+        for( i = 0; i < config->max_groups; i++ ) {
+            if( ( events_table[ event_id ].group == config->groups[ i ] ) && ( config->groups[ i ] != events_group_threads ) ) {
+                forwarded = 1;
+            }
+        }
+        if( forwarded ) {
+            link->handlers[ link->thread_ctrl.max_event_handlers ].event_id = event_id;
+            link->handlers[ link->thread_ctrl.max_event_handlers ].handler  = bridge_forward_handler;
+            link->thread_ctrl.max_event_handlers++;
+        }
+    }
+
+    // link's thread is terminated like any other module
+    memcpy( link->groups, config->groups, config->max_groups * sizeof( events_group_t ) );
+    link->groups[ config->max_groups ] = events_group_threads;
+
+    link->thread_ctrl.module_id                 = config->module_id;
+    link->thread_ctrl.max_groups                = config->max_groups + 1;
+    link->thread_ctrl.groups                    = link->groups;
+    link->thread_ctrl.handlers                  = link->handlers;
+    link->thread_ctrl.timedwait_milliseconds    = link->config.reconnect_milliseconds;
+    link->thread_ctrl.timed_ops                 = bridge_link_timed_operations;
+    link->thread_ctrl.max_event_filters         = 0;
+    link->thread_ctrl.filters                   = NULL;
+
+    if( pthread_create( &link->thread_id, NULL, bridge_link_thread, ( void* )( link ) ) != 0 ) {
+        free( link );
+        return NULL;
+    }
+
+    return link;
+}
+
+// wait link's thread termination (after ev_terminate_thread), flush last events and release link
+void bridge_link_stop( bridge_link_t *link )
+{
+    pthread_join( link->thread_id, NULL );
+
+    bridge_link_flush( link, bridge_millis() );
+    if( link->fd >= 0 ) {
+        close( link->fd );
+    }
+
+    free( link );
+}
+
+// read link counters
+void bridge_link_get_stats( bridge_link_t *link, bridge_stats_t *stats )
+{
+    bridge_read_stats( &link->stats, stats );
+}
+
+// ------------------- outbound link (end) ---------------------------------
+
+// ------------------- inbound server (start) ---------------------------------
+
+// check if a received event can be re-injected on this node
+static int bridge_server_accepts( bridge_server_t *server, uint32_t node_id, uint32_t event_id )
+{
+    // events coming back to the node they were produced on are discarded (loop prevention)
+    if( ( node_id == 0 ) || ( node_id == server->config.node_id ) ) {
+        return 0;
+    }
+
+    // remote nodes can't control local threads, nor send groups this node didn't agree to share
+    if( ( event_id >= ev_max ) || !server->accepted[ events_table[ event_id ].group ] ) {
+        return 0;
+    }
+
+    return 1;
+}
+
+// re-inject complete frames received on connection, return 0 on protocol error
+static int bridge_server_parse( bridge_server_t *server, bridge_connection_t *connection )
+{
+    uint8_t     *p;
+    uint32_t    node_id;
+    uint32_t    count;
+    uint32_t    length;
+    uint32_t    i;
+
+    while( connection->length >= BRIDGE_FRAME_HEADER_SIZE ) {
+
+        p = connection->buffer;
+        count = get_u16( p + 8 );
+        if( ( get_u16( p ) != BRIDGE_FRAME_MAGIC ) || ( p[ 2 ] != BRIDGE_FRAME_VERSION ) || ( count > BRIDGE_BATCH_EVENTS ) ) {
+            return 0;
+        }
+
+        length = BRIDGE_FRAME_HEADER_SIZE + count * BRIDGE_FRAME_EVENT_SIZE;
+        if( connection->length < length ) {
+            break;
+        }
+
+        // a flow controlled group makes the server wait for credits, pushing back on remote link through TCP
+        // NOTE re-injected events are stamped with local time, remote timestamp is not kept
+        node_id = get_u32( p + 4 );
+        p += BRIDGE_FRAME_HEADER_SIZE;
+        for( i = 0; i < count; i++, p += BRIDGE_FRAME_EVENT_SIZE ) {
+            if( !bridge_server_accepts( server, node_id, get_u32( p ) ) ||
+                ( send_event_from_node( ( event_id_t ) get_u32( p ), get_u32( p + 4 ), node_id, BRIDGE_SERVER_POLL_MILLISECONDS ) != event_sent ) ) {
+                bridge_count( &server->stats.dropped, 1 );
+            } else {
+                bridge_count( &server->stats.events, 1 );
+            }
+        }
+
+        bridge_count( &server->stats.frames, 1 );
+        connection->length -= length;
+        memmove( connection->buffer, connection->buffer + length, connection->length );
+    }
+
+    return 1;
+}
+
+// close an inbound connection and compact connections array
+static void bridge_server_close( bridge_server_t *server, uint32_t index )
+{
+    close( server->connections[ index ].fd );
+    server->max_connections--;
+    if( index != server->max_connections ) {
+        server->connections[ index ] = server->connections[ server->max_connections ];
+    }
+}
+
+// server's thread: accept links and read their frames
+static void* bridge_server_thread( void *arg )
+{
+    bridge_server_t         *server = ( bridge_server_t * ) arg;
+    bridge_connection_t     *connection;
+    struct pollfd           fds[ BRIDGE_MAX_CONNECTIONS + 1 ];
+    ssize_t                 received;
+    uint32_t                max_fds;
+    uint32_t                i;
+    int                     fd;
+
+    while( __atomic_load_n( &server->running, __ATOMIC_ACQUIRE ) ) {
+
+        fds[ 0 ].fd = server->fd;
+        fds[ 0 ].events = POLLIN;
+        for( i = 0; i < server->max_connections; i++ ) {
+            fds[ i + 1 ].fd = server->connections[ i ].fd;
+            fds[ i + 1 ].events = POLLIN;
+        }
+        max_fds = server->max_connections + 1;
+
+        if( poll( fds, max_fds, BRIDGE_SERVER_POLL_MILLISECONDS ) <= 0 ) {
+            continue;
+        }
+
+        // read connections backwards, closing one moves the last into its place
+        for( i = max_fds - 1; i > 0; i-- ) {
+            if( fds[ i ].revents == 0 ) {
+                continue;
+            }
+            connection = &server->connections[ i - 1 ];
+            received = recv( connection->fd, connection->buffer + connection->length,
+                             sizeof( connection->buffer ) - connection->length, 0 );
+            if( ( received <= 0 ) && ( ( received == 0 ) || ( errno != EINTR ) ) ) {
+                bridge_server_close( server, i - 1 );
+                continue;
+            }
+            if( received > 0 ) {
+                bridge_count( &server->stats.bytes, ( uint64_t ) received );
+                connection->length += ( uint32_t ) received;
+                if( !bridge_server_parse( server, connection ) ) {
+#ifdef EVENT_MANAGER_DEBUG
+                    printf( "[ BRDG  ] Node %d protocol error, closing link\n", server->config.node_id );
+#endif
+                    bridge_server_close( server, i - 1 );
+                }
+            }
+        }
+
+        // accept new links
+        if( fds[ 0 ].revents & POLLIN ) {
+            fd = accept( server->fd, NULL, NULL );
+            if( fd >= 0 ) {
+                if( server->max_connections == BRIDGE_MAX_CONNECTIONS ) {
+                    close( fd );
+                } else {
+                    server->connections[ server->max_connections ].fd = fd;
+                    server->connections[ server->max_connections ].length = 0;
+                    server->max_connections++;
+                    bridge_count( &server->stats.connections, 1 );
+                }
+            }
+        }
+    }
+
+    while( server->max_connections > 0 ) {
+        bridge_server_close( server, server->max_connections - 1 );
+    }
+
+    return NULL;
+}
+
+// start accepting links from remote nodes, NULL on error
+bridge_server_t* bridge_server_start( bridge_server_config_t *config )
+{
+    bridge_server_t *server;
+    uint32_t        i;
+
+    server = ( bridge_server_t * ) calloc( 1, sizeof( bridge_server_t ) );
+    if( server == NULL ) {
+        return NULL;
+    }
+
+    server->config = *config;
+
+    // accepted groups, thread control events are never taken from remote nodes
+    for( i = 0; i < events_group_max; i++ ) {
+        server->accepted[ i ] = ( config->max_groups == 0 );
+    }
+    for( i = 0; i < config->max_groups; i++ ) {
+        if( ( config->groups[ i ] >= 0 ) && ( config->groups[ i ] < events_group_max ) ) {
+            server->accepted[ config->groups[ i ] ] = 1;
+        }
+    }
+    server->accepted[ events_group_threads ] = 0;
+    server->config.groups = NULL;
+
+    server->fd = bridge_listen( config->transport, config->address, config->port );
+    if( server->fd < 0 ) {
+        free( server );
+        return NULL;
+    }
+
+    server->running = 1;
+    if( pthread_create( &server->thread_id, NULL, bridge_server_thread, ( void* )( server ) ) != 0 ) {
+        close( server->fd );
+        free( server );
+        return NULL;
+    }
+
+    return server;
+}
+
+// stop server, close its connections and release it
+void bridge_server_stop( bridge_server_t *server )
+{
+    __atomic_store_n( &server->running, 0, __ATOMIC_RELEASE );
+    pthread_join( server->thread_id, NULL );
+
+    close( server->fd );
+    if( server->config.transport == bridge_unix ) {
+        unlink( server->config.address );
+    }
+
+    free( server );
+}
+
+// read server counters
+void bridge_server_get_stats( bridge_server_t *server, bridge_stats_t *stats )
+{
+    bridge_read_stats( &server->stats, stats );
+}
+
+// ------------------- inbound server (end) ---------------------------------
@@ -0,0 +1,119 @@
+/**
+ * Copyright 2024 Daniele Brunello daniele.brunello.dev@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EVENT_BRIDGE_H__
+#define __EVENT_BRIDGE_H__
+
+#include <stdint.h>
+#include "event_manager.h"
+#include "events_table.h"
+
+// max events sent in a single frame
+#define BRIDGE_BATCH_EVENTS             128
+
+// max links a bridge server accepts at the same time
+#define BRIDGE_MAX_CONNECTIONS          16
+
+/*
+    frame format (all fields in network byte order)
+
+    header  magic       16 bit  BRIDGE_FRAME_MAGIC
+            version     8 bit   BRIDGE_FRAME_VERSION
+            reserved    8 bit
+            node id     32 bit  node the events were sent from
+            count       16 bit  number of events following
+            reserved    16 bit
+    event   id          32 bit
+            data        32 bit
+            timestamp   64 bit
+*/
+#define BRIDGE_FRAME_MAGIC              0x4542
+#define BRIDGE_FRAME_VERSION            1
+#define BRIDGE_FRAME_HEADER_SIZE        12
+#define BRIDGE_FRAME_EVENT_SIZE         16
+
+// socket type used by a bridge
+typedef enum {
+    bridge_tcp,                 // address is an IPv4 address, port is used
+    bridge_unix                 // address is a unix domain socket path
+} bridge_transport_t;
+
+/*
+    outbound link configuration
+
+    a link is an event processing thread subscribed to the forwarded groups, events are collected
+    in a batch and sent when the batch is full or flush_milliseconds after the first event.
+    only events produced on this node (origin 0) are forwarded, so events received from another
+    node are never sent back (nodes sharing a group must be linked to each other directly).
+    when the connection is lost events are kept in the batch until it's full, then dropped,
+    and a new connection is tried every reconnect_milliseconds. connecting and sending wait at most
+    reconnect_milliseconds, so an unreachable or stuck remote node never stalls link's thread for long.
+    send ev_terminate_thread (events_group_threads) before calling bridge_link_stop
+*/
+typedef struct {
+    uint32_t            node_id;                    // this node (non zero, unique among bridged nodes)
+    uint32_t            module_id;                  // unique id of link's thread
+    uint32_t            max_groups;                 // number of forwarded groups
+    events_group_t      *groups;                    // forwarded groups
+    bridge_transport_t  transport;                  // socket type
+    const char          *address;                   // remote address or socket path
+    uint16_t            port;                       // remote port (bridge_tcp)
+    int32_t             flush_milliseconds;         // max time an event waits in batch
+    int32_t             reconnect_milliseconds;     // time between connection attempts, max connect / send time (0 = 1000)
+} bridge_link_config_t;
+
+// inbound (server) configuration, events received are re-injected through send_event_from_node
+// only events of the accepted groups are re-injected, events_group_threads is never accepted
+typedef struct {
+    uint32_t            node_id;                    // this node, frames coming from it are discarded
+    uint32_t            max_groups;                 // number of accepted groups (0 = every group)
+    events_group_t      *groups;                    // groups shared with remote nodes
+    bridge_transport_t  transport;                  // socket type
+    const char          *address;                   // local address to bind or socket path
+    uint16_t            port;                       // local port (bridge_tcp)
+} bridge_server_config_t;
+
+// link / server throughput counters
+typedef struct {
+    uint64_t            frames;                     // frames sent / received
+    uint64_t            events;                     // events sent / re-injected
+    uint64_t            bytes;                      // bytes sent / received
+    uint64_t            dropped;                    // link: lost while disconnected, server: refused or looped back
+    uint64_t            connections;                // link: (re)connections, server: accepted links
+} bridge_stats_t;
+
+typedef struct bridge_link bridge_link_t;
+typedef struct bridge_server bridge_server_t;
+
+// start forwarding selected groups to a remote node, NULL on error
+bridge_link_t* bridge_link_start( bridge_link_config_t *config );
+
+// wait link's thread termination (after ev_terminate_thread), flush last events and release link
+void bridge_link_stop( bridge_link_t *link );
+
+// start accepting links from remote nodes, NULL on error
+bridge_server_t* bridge_server_start( bridge_server_config_t *config );
+
+// stop server, close its connections and release it
+void bridge_server_stop( bridge_server_t *server );
+
+// read link counters
+void bridge_link_get_stats( bridge_link_t *link, bridge_stats_t *stats );
+
+// read server counters
+void bridge_server_get_stats( bridge_server_t *server, bridge_stats_t *stats );
+
+#endif
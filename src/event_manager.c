@@ -17,6 +17,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sched.h>
 #include <sys/time.h>
 #include "event_manager.h"
 #include "events_table.h"
@@ -31,6 +32,106 @@ typedef struct event_listener_node {
 // list of threads listening for specific events group
 static event_listener_node_t      *event_group_listeners[ events_group_max ];
 
+// broadcast ring slot, sequence is a seqlock: 0 while slot is being written, n + 1 when event n is stored
+typedef struct {
+    uint64_t                    sequence;
+    event_object_t              event_object;
+} ring_slot_t;
+
+// shared broadcast ring written once per event, each listener reads it through its own cursor
+typedef struct {
+    ring_slot_t                 slots[ GROUP_BROADCAST_RING_SIZE ];
+    uint64_t                    published;      // number of events published so far
+    uint64_t                    gating;         // cached cursor of slowest listener (group_dispatch_ring_block)
+    uint32_t                    waiters;        // producers waiting for room in send_event_wait
+    pthread_mutex_t             mutex;          // serialize producers
+    pthread_cond_t              cond;           // signaled when listeners free slots (group_dispatch_ring_block)
+} broadcast_ring_t;
+
+// broadcast rings (used only by groups not dispatched through listeners' queues)
+static broadcast_ring_t           group_rings[ events_group_max ];
+
+// dispatch sequence of last event sent, shared by queues and rings to keep send order
+static uint64_t                   event_sequence;
+
+// flow control state of a group
+typedef struct {
+    uint32_t                    listeners;      // listeners subscribed, each event is charged once per listener
+    uint32_t                    in_flight;      // event copies sent and not yet dequeued by listeners
+    uint32_t                    waiters;        // producers waiting in send_event_wait
+    uint64_t                    would_block;    // sends refused for lack of credits
+    uint64_t                    rate_limited;   // sends refused by token buckets
+    pthread_mutex_t             mutex;
+    pthread_cond_t              cond;           // signaled when credits are given back
+} group_flow_t;
+
+// token bucket of an event, tokens are counted in thousandths to refill with millisecond resolution
+typedef struct {
+    uint64_t                    tokens;
+    int64_t                     last_refill;
+} token_bucket_t;
+
+// flow control state (credits are used only by groups with events_groups_table credits)
+static group_flow_t               group_flows[ events_group_max ];
+
+// token buckets (used only by events with events_table rate)
+static token_bucket_t             event_buckets[ ev_max ];
+
+// wait node of a suspended task
+typedef struct event_await {
+    event_task_t                *task;
+    int                         match_data;     // resume only on event with given data
+    uint32_t                    data;
+    int64_t                     deadline;       // timestamp in milliseconds of timeout (0 = none)
+    struct event_await          *next;
+} event_await_t;
+
+// last event sent for each event id, sequence is a seqlock: odd while slot is being written, 0 = never written
+typedef struct {
+    uint32_t                    sequence;
+    event_object_t              event_object;
+} last_value_slot_t;
+
+// last values (used only by events with events_table last_value)
+static last_value_slot_t          last_values[ ev_max ];
+
+// data of event processing thread running on the calling thread (NULL for other threads)
+static __thread thread_data_t     *current_thread_data;
+
+// list of all running event processing threads (used to drive virtual clock)
+static event_listener_node_t      *event_threads;
+static uint32_t                   event_threads_count;
+static pthread_mutex_t            event_threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t             event_threads_cond = PTHREAD_COND_INITIALIZER;     // signaled when a thread is ready
+
+// time source of event manager (NULL = wall clock)
+static event_time_source_t        event_time_source;
+
+// virtual clock state
+static int                        virtual_clock_enabled;
+static int64_t                    virtual_clock_now;
+static uint64_t                   virtual_clock_activity;     // incremented every time an event is handed to a thread
+
+// get wall clock timestamp in milliseconds
+static int64_t wall_clock_millis() {
+    struct timeval te;
+    gettimeofday(&te, NULL); // Get current time
+    int64_t milliseconds = te.tv_sec * 1000LL + te.tv_usec / 1000; // Calculate milliseconds
+    return milliseconds;
+}
+
+// get timesatmp in milliseconds from event manager time source
+static int64_t current_timestamp_millis() {
+    if( virtual_clock_enabled ) {
+        return __atomic_load_n( &virtual_clock_now, __ATOMIC_SEQ_CST );
+    }
+    if( event_time_source != NULL ) {
+        return event_time_source();
+    }
+    return wall_clock_millis();
+}
+
+
 // print pointer of all thread listening for each specific group of events
 void debug_event_group_listeners_list()
 {
@@ -56,12 +157,138 @@ void debug_event_group_listeners_list()
     }
 }
 
+// max tokens (in thousandths) event's bucket can hold
+static uint64_t token_bucket_capacity( event_id_t event_id )
+{
+    uint32_t burst = events_table[ event_id ].burst;
+
+    return ( uint64_t )( burst > 0 ? burst : 1 ) * 1000;
+}
+
+// add tokens earned since last refill (flow mutex of event's group must be locked)
+static void token_bucket_refill( event_id_t event_id, int64_t now )
+{
+    token_bucket_t  *bucket = &event_buckets[ event_id ];
+    uint64_t        capacity = token_bucket_capacity( event_id );
+    uint64_t        elapsed;
+
+    // time source moved backwards (replaced or virtual clock enabled), count elapsed time from now on
+    if( now < bucket->last_refill ) {
+        bucket->last_refill = now;
+    }
+
+    if( now > bucket->last_refill ) {
+        elapsed = now - bucket->last_refill;
+        // rate is at least 1 token per second, so after "capacity" ms the bucket is surely full
+        if( elapsed >= capacity ) {
+            bucket->tokens = capacity;
+        } else {
+            bucket->tokens += elapsed * events_table[ event_id ].rate;
+            if( bucket->tokens > capacity ) {
+                bucket->tokens = capacity;
+            }
+        }
+        bucket->last_refill = now;
+    }
+}
+
+// try to take a token and group's credits for event (flow mutex of event's group must be locked)
+// on success charged is set to the credits taken, else wait_ms tells when to retry (0 = until credits are given back)
+static event_send_status_t flow_try_acquire( event_id_t event_id, int64_t now, uint32_t *charged, uint32_t *wait_ms )
+{
+    events_group_t  group = events_table[ event_id ].group;
+    group_flow_t    *flow = &group_flows[ group ];
+    token_bucket_t  *bucket = &event_buckets[ event_id ];
+    uint32_t        rate = events_table[ event_id ].rate;
+    uint32_t        credits = events_groups_table[ group ].credits;
+
+    if( rate > 0 ) {
+        token_bucket_refill( event_id, now );
+        if( bucket->tokens < 1000 ) {
+            *wait_ms = ( uint32_t )( ( 1000 - bucket->tokens + rate - 1 ) / rate );
+            return event_rate_limited;
+        }
+    }
+
+    if( ( credits > 0 ) && ( flow->in_flight >= credits ) ) {
+        *wait_ms = 0;
+        return event_would_block;
+    }
+
+    if( rate > 0 ) {
+        bucket->tokens -= 1000;
+    }
+    *charged = 0;
+    if( credits > 0 ) {
+        *charged = flow->listeners;
+        flow->in_flight += flow->listeners;
+    }
+
+    return event_sent;
+}
+
+// give back group's credits when listeners dequeue events (or events are not delivered at all)
+static void flow_release( events_group_t group, uint32_t count )
+{
+    group_flow_t    *flow = &group_flows[ group ];
+
+    if( ( events_groups_table[ group ].credits == 0 ) || ( count == 0 ) ) {
+        return;
+    }
+
+    pthread_mutex_lock( &flow->mutex );
+    flow->in_flight -= ( count < flow->in_flight ) ? count : flow->in_flight;
+    if( flow->waiters > 0 ) {
+        pthread_cond_broadcast( &flow->cond );
+    }
+    pthread_mutex_unlock( &flow->mutex );
+}
+
+// print flow control state and counters of each group
+void debug_event_groups_flow()
+{
+    group_flow_t    *flow;
+    int i;
+
+    for( i = 0; i < events_group_max; i++ ) {
+        flow = &group_flows[ i ];
+        pthread_mutex_lock( &flow->mutex );
+        printf( "[ EVMNG ] Flow of event group %d -> listeners %u in flight %u / %u would block %llu rate limited %llu\n",
+                i, flow->listeners, flow->in_flight, events_groups_table[ i ].credits,
+                ( unsigned long long ) flow->would_block, ( unsigned long long ) flow->rate_limited );
+        pthread_mutex_unlock( &flow->mutex );
+    }
+}
+
 // initialize event manager module
 void initialize_event_manager() {
 
+    int i;
+
     // reset thread list pointers
     memset( &event_group_listeners, 0, sizeof( event_group_listeners ) );
 
+    // reset broadcast rings
+    memset( &group_rings, 0, sizeof( group_rings ) );
+    for( i = 0; i < events_group_max; i++ ) {
+        pthread_mutex_init( &group_rings[ i ].mutex, NULL );
+        pthread_cond_init( &group_rings[ i ].cond, NULL );
+    }
+
+    // reset last values
+    memset( &last_values, 0, sizeof( last_values ) );
+
+    // reset flow control, token buckets start full
+    memset( &group_flows, 0, sizeof( group_flows ) );
+    for( i = 0; i < events_group_max; i++ ) {
+        pthread_mutex_init( &group_flows[ i ].mutex, NULL );
+        pthread_cond_init( &group_flows[ i ].cond, NULL );
+    }
+    for( i = 0; i < ev_max; i++ ) {
+        event_buckets[ i ].tokens       = token_bucket_capacity( i );
+        event_buckets[ i ].last_refill  = current_timestamp_millis();
+    }
+
 }
 
 // called by a thread to subscribe to an event group
@@ -78,6 +305,18 @@ void subscribe_for_events_group( thread_data_t *thread_data, events_group_t even
         return;
     }
 
+    // a new ring listener starts reading from the next event published
+    if( events_groups_table[ event_group ].dispatch != group_dispatch_queue ) {
+        pthread_mutex_lock( &group_rings[ event_group ].mutex );
+        thread_data->ring_cursor[ event_group ] = group_rings[ event_group ].published;
+        pthread_mutex_unlock( &group_rings[ event_group ].mutex );
+    }
+
+    // each event sent to the group is charged once more
+    pthread_mutex_lock( &group_flows[ event_group ].mutex );
+    group_flows[ event_group ].listeners++;
+    pthread_mutex_unlock( &group_flows[ event_group ].mutex );
+
     if( event_group_listeners[ event_group ] != NULL ) {
         event_listener_node_t   *p;
 
@@ -136,8 +375,9 @@ event_object_t dequeue_event( event_queue *queue ) {
     return event_object;
 }
 
-// dispatch event to specific threads
-static void dispatch_event( thread_data_t *thread_data, event_object_t event_object ) {
+// dispatch event to specific threads, return 0 if thread's queue is full
+static int dispatch_event( thread_data_t *thread_data, event_object_t event_object ) {
+    int enqueued = 0;
 
 #ifdef EVENT_MANAGER_DEBUG
     printf("[ EVMNG ] Dispatching event %d to thread %d %p\n", event_object.id, thread_data->thread_id, thread_data );
@@ -159,6 +399,8 @@ static void dispatch_event( thread_data_t *thread_data, event_object_t event_obj
             thread_data->queue.rear = ( thread_data->queue.rear + 1 ) % THREAD_EVENT_QUEUE_SIZE;
         }
         thread_data->queue.events[ thread_data->queue.rear ] = event_object;
+        thread_data->idle = 0;
+        enqueued = 1;
 
 #ifdef EVENT_MANAGER_DEBUG
         printf("[ EVMNG ] Event %d enqueued for thread %d\n", event_object.id, thread_data->thread_id );
@@ -170,45 +412,785 @@ static void dispatch_event( thread_data_t *thread_data, event_object_t event_obj
 
     // signal condition variable to wake up thread and read the event
     pthread_cond_signal( &thread_data->cond );
+
+    // virtual clock is idle only when nothing was handed to threads while checking them
+    if( virtual_clock_enabled ) {
+        __atomic_fetch_add( &virtual_clock_activity, 1, __ATOMIC_SEQ_CST );
+    }
+
+    return enqueued;
 }
 
-// get timesatmp in milliseconds
-static int64_t current_timestamp_millis() {
-    struct timeval te;
-    gettimeofday(&te, NULL); // Get current time
-    int64_t milliseconds = te.tv_sec * 1000LL + te.tv_usec / 1000; // Calculate milliseconds
-    return milliseconds;
+// compare function used to sort filter_set values
+static int compare_filter_values( const void *a, const void *b )
+{
+    uint32_t va = *( const uint32_t * ) a;
+    uint32_t vb = *( const uint32_t * ) b;
+
+    return ( va > vb ) - ( va < vb );
+}
+
+// prepare module's filters and link them to thread's per event lookup table
+static void compile_event_filters( thread_data_t *thread_data, thread_ctrl_t *thread_ctrl )
+{
+    event_filter_t  *filter;
+    int i;
+
+    memset( thread_data->filters, 0, sizeof( thread_data->filters ) );
+
+    for( i = 0; i < thread_ctrl->max_event_filters; i++ ) {
+        filter = &thread_ctrl->filters[ i ];
+
+        if( ( filter->event_id < 0 ) || ( filter->event_id >= ev_max ) ) {
+#ifdef EVENT_MANAGER_DEBUG
+            printf( "[ EVMNG ] Error. Wrong filter event id %d\n", filter->event_id );
+#endif
+            continue;
+        }
+
+        // sort set values once so each check is a binary search
+        if( ( filter->type == filter_set ) && ( filter->values != NULL ) ) {
+            qsort( filter->values, filter->max_values, sizeof( uint32_t ), compare_filter_values );
+        }
+
+        filter->hits    = 0;
+        filter->misses  = 0;
+        thread_data->filters[ filter->event_id ] = filter;
+    }
+}
+
+// check event against thread's filter (if any), counters are not updated
+static int event_filter_check( thread_data_t *thread_data, event_object_t event_object )
+{
+    event_filter_t  *filter = thread_data->filters[ event_object.id ];
+    int             accepted;
+
+    if( filter == NULL ) {
+        return 1;
+    }
+
+    switch( filter->type ) {
+        case filter_predicate:
+            accepted = ( filter->predicate == NULL ) || filter->predicate( event_object );
+            break;
+        case filter_mask:
+            accepted = ( ( event_object.data & filter->mask ) == filter->value );
+            break;
+        case filter_range:
+            accepted = ( event_object.data >= filter->min ) && ( event_object.data <= filter->max );
+            break;
+        case filter_set:
+            accepted = ( filter->values != NULL ) &&
+                       ( bsearch( &event_object.data, filter->values, filter->max_values,
+                                  sizeof( uint32_t ), compare_filter_values ) != NULL );
+            break;
+        default:
+            accepted = 1;
+            break;
+    }
+
+    return accepted;
+}
+
+// update counters of thread's filter (if any) with the outcome of a check
+static void event_filter_count( thread_data_t *thread_data, event_object_t event_object, int accepted )
+{
+    event_filter_t  *filter = thread_data->filters[ event_object.id ];
+
+    if( filter == NULL ) {
+        return;
+    }
+
+    // counters can be updated by several producers at the same time
+    if( accepted ) {
+        __atomic_fetch_add( &filter->hits, 1, __ATOMIC_RELAXED );
+    } else {
+        __atomic_fetch_add( &filter->misses, 1, __ATOMIC_RELAXED );
+#ifdef EVENT_MANAGER_DEBUG
+        printf( "[ EVMNG ] Event %d data %d filtered out for thread %d\n", event_object.id, event_object.data, thread_data->thread_id );
+#endif
+    }
+}
+
+// check event against thread's filter (if any) and update filter counters
+static int event_filter_accepts( thread_data_t *thread_data, event_object_t event_object )
+{
+    int accepted = event_filter_check( thread_data, event_object );
+
+    event_filter_count( thread_data, event_object, accepted );
+
+    return accepted;
 }
 
-// send event to dispachter
-void send_event( event_id_t event_id, uint32_t data )
+// print hits / misses counters of module's filters
+void debug_event_filters( thread_ctrl_t *thread_ctrl )
+{
+    int i;
+
+    for( i = 0; i < thread_ctrl->max_event_filters; i++ ) {
+        printf( "[ EVMNG ] Module %d filter on event %d -> hits %llu misses %llu\n",
+                thread_ctrl->module_id,
+                thread_ctrl->filters[ i ].event_id,
+                ( unsigned long long ) __atomic_load_n( &thread_ctrl->filters[ i ].hits, __ATOMIC_RELAXED ),
+                ( unsigned long long ) __atomic_load_n( &thread_ctrl->filters[ i ].misses, __ATOMIC_RELAXED ) );
+    }
+}
+
+// get slowest listener cursor of a broadcast ring
+static uint64_t ring_slowest_cursor( events_group_t group, uint64_t sequence )
 {
     event_listener_node_t   *p;
-    events_group_t          group;
+    uint64_t                cursor;
+    uint64_t                slowest = sequence;
+
+    p = event_group_listeners[ group ];
+    while( p != NULL ) {
+        cursor = __atomic_load_n( &p->thread_data->ring_cursor[ group ], __ATOMIC_SEQ_CST );
+        if( cursor < slowest ) {
+            slowest = cursor;
+        }
+        p = p->next;
+    }
+
+    return slowest;
+}
+
+// check if group's broadcast ring can take one more event (ring mutex must be locked)
+// gating cursor is cached, listeners are scanned again only when producer reaches it
+static int ring_has_room( events_group_t group )
+{
+    broadcast_ring_t        *ring = &group_rings[ group ];
+    uint64_t                sequence = ring->published;
+
+    // slot is free only when every listener has read the event stored GROUP_BROADCAST_RING_SIZE events ago
+    if( events_groups_table[ group ].dispatch != group_dispatch_ring_block ) {
+        return 1;
+    }
+
+    if( sequence - ring->gating >= GROUP_BROADCAST_RING_SIZE ) {
+        ring->gating = ring_slowest_cursor( group, sequence );
+    }
+
+    return ( sequence - ring->gating < GROUP_BROADCAST_RING_SIZE );
+}
+
+// write event once into group's broadcast ring (ring mutex must be locked and ring must have room)
+static void publish_event( events_group_t group, event_object_t event_object )
+{
+    broadcast_ring_t        *ring = &group_rings[ group ];
+    ring_slot_t             *slot;
+    uint64_t                sequence = ring->published;
+
+    slot = &ring->slots[ sequence & ( GROUP_BROADCAST_RING_SIZE - 1 ) ];
+    __atomic_store_n( &slot->sequence, 0, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    slot->event_object = event_object;
+    __atomic_store_n( &slot->sequence, sequence + 1, __ATOMIC_RELEASE );
+    __atomic_store_n( &ring->published, sequence + 1, __ATOMIC_SEQ_CST );
 
 #ifdef EVENT_MANAGER_DEBUG
-    printf( "[ EVMNG ] Dispatching event %d\n", event_id );
+    printf("[ EVMNG ] Event %d published on group %d ring, sequence %llu\n", event_object.id, group, ( unsigned long long ) sequence );
 #endif
+}
+
+// wake up parked listeners of group's broadcast ring after publishing an event
+static void ring_wake_listeners( events_group_t group )
+{
+    event_listener_node_t   *p;
+
+    // only listeners waiting on their condition variable need a signal, busy ones will find the event
+    p = event_group_listeners[ group ];
+    while( p != NULL ) {
+        if( __atomic_load_n( &p->thread_data->parked, __ATOMIC_SEQ_CST ) ) {
+            pthread_mutex_lock( &p->thread_data->mutex );
+            p->thread_data->idle = 0;
+            pthread_cond_signal( &p->thread_data->cond );
+            pthread_mutex_unlock( &p->thread_data->mutex );
+        }
+        p = p->next;
+    }
+
+    if( virtual_clock_enabled ) {
+        __atomic_fetch_add( &virtual_clock_activity, 1, __ATOMIC_SEQ_CST );
+    }
+}
+
+// wake up producers waiting for room in group's broadcast ring after a listener moved its cursor
+static void ring_room_released( events_group_t group )
+{
+    broadcast_ring_t        *ring = &group_rings[ group ];
+
+    // cursor is stored before reading waiters, a producer going to wait either sees it or is signaled
+    if( __atomic_load_n( &ring->waiters, __ATOMIC_SEQ_CST ) > 0 ) {
+        pthread_mutex_lock( &ring->mutex );
+        pthread_cond_broadcast( &ring->cond );
+        pthread_mutex_unlock( &ring->mutex );
+    }
+}
+
+// check if any broadcast ring the thread listens to has events not read yet
+static int ring_is_pending( thread_data_t *thread_data, thread_ctrl_t *thread_ctrl )
+{
+    events_group_t  group;
+    uint32_t i;
+
+    for( i = 0; i < thread_ctrl->max_groups; i++ ) {
+        group = thread_ctrl->groups[ i ];
+        if( ( events_groups_table[ group ].dispatch != group_dispatch_queue ) &&
+            ( __atomic_load_n( &group_rings[ group ].published, __ATOMIC_SEQ_CST ) != thread_data->ring_cursor[ group ] ) ) {
+            return 1;
+        }
+    }
 
-    if( ( event_id >= 0 ) && ( event_id < ev_max ) ) {
+    return 0;
+}
+
+// get next event of group's broadcast ring accepted by thread's filter without consuming it, return 0 if none
+// events lost by a slow listener or filtered out are skipped and their credits given back
+static int ring_peek_event( thread_data_t *thread_data, events_group_t group, event_object_t *event_object )
+{
+    broadcast_ring_t    *ring = &group_rings[ group ];
+    ring_slot_t         *slot;
+    uint64_t            cursor = thread_data->ring_cursor[ group ];
+    uint64_t            start = cursor;
+    uint64_t            published;
+    int                 found = 0;
+
+    while( !found ) {
+        published = __atomic_load_n( &ring->published, __ATOMIC_ACQUIRE );
+        if( cursor == published ) {
+            break;
+        }
+
+        // too slow, events older than ring size are gone (group_dispatch_ring_drop)
+        if( published - cursor > GROUP_BROADCAST_RING_SIZE ) {
+            thread_data->ring_overruns += published - cursor - GROUP_BROADCAST_RING_SIZE;
+            cursor = published - GROUP_BROADCAST_RING_SIZE;
+        }
+
+        slot = &ring->slots[ cursor & ( GROUP_BROADCAST_RING_SIZE - 1 ) ];
+        if( __atomic_load_n( &slot->sequence, __ATOMIC_ACQUIRE ) == cursor + 1 ) {
+            *event_object = slot->event_object;
+            __atomic_thread_fence( __ATOMIC_ACQUIRE );
+            if( __atomic_load_n( &slot->sequence, __ATOMIC_RELAXED ) == cursor + 1 ) {
+                // ring is shared by all listeners, so filters can only be checked by the reader
+                // the event may be peeked again, hits are counted once consumed
+                found = event_filter_check( thread_data, *event_object );
+                if( !found ) {
+                    event_filter_count( thread_data, *event_object, 0 );
+                    cursor++;
+                }
+                continue;
+            }
+        }
+
+        // slot overwritten while reading it, skip the event
+        thread_data->ring_overruns++;
+        cursor++;
+    }
+
+    // every event lost or filtered out gives its credit back
+    if( cursor != start ) {
+        __atomic_store_n( &thread_data->ring_cursor[ group ], cursor, __ATOMIC_SEQ_CST );
+        flow_release( group, ( uint32_t )( cursor - start ) );
+        ring_room_released( group );
+    }
+
+    return found;
+}
+
+// consume event returned by ring_peek_event
+static void ring_consume_event( thread_data_t *thread_data, events_group_t group, event_object_t event_object )
+{
+    __atomic_store_n( &thread_data->ring_cursor[ group ], thread_data->ring_cursor[ group ] + 1, __ATOMIC_SEQ_CST );
+    flow_release( group, 1 );
+    ring_room_released( group );
+    event_filter_count( thread_data, event_object, 1 );
+}
+
+// take the oldest event (lowest dispatch sequence) among private queue and broadcast rings the thread listens to,
+// so that events are handled in send order whatever the dispatch of their group, return id -1 if there is none
+static event_object_t dequeue_oldest_event( thread_data_t *thread_data, thread_ctrl_t *thread_ctrl )
+{
+    event_object_t  event_object = { .id = -1 };
+    event_object_t  head;
+    events_group_t  group;
+    int             oldest_group = -1;      // -1 = private queue
+    uint32_t i;
+
+    if( !queue_is_empty( &thread_data->queue ) ) {
+        event_object = thread_data->queue.events[ thread_data->queue.front ];
+    }
+
+    for( i = 0; i < thread_ctrl->max_groups; i++ ) {
+        group = thread_ctrl->groups[ i ];
+        if( ( events_groups_table[ group ].dispatch != group_dispatch_queue ) &&
+            ring_peek_event( thread_data, group, &head ) &&
+            ( ( event_object.id == -1 ) || ( head.sequence < event_object.sequence ) ) ) {
+            event_object = head;
+            oldest_group = group;
+        }
+    }
+
+    if( oldest_group >= 0 ) {
+        ring_consume_event( thread_data, oldest_group, event_object );
+    } else if( event_object.id != -1 ) {
+        event_object = dequeue_event( &thread_data->queue );
+        flow_release( events_table[ event_object.id ].group, 1 );
+    }
+
+    return event_object;
+}
+
+// store last event sent, concurrent producers of the same event take turns on the seqlock
+// an event older (lower dispatch sequence) than the stored one is not written, the slot keeps the most recent
+static void store_last_value( event_object_t event_object )
+{
+    last_value_slot_t   *slot = &last_values[ event_object.id ];
+    uint32_t            sequence;
+
+    while( 1 ) {
+        sequence = __atomic_load_n( &slot->sequence, __ATOMIC_RELAXED );
+        if( ( ( sequence & 1 ) == 0 ) &&
+            __atomic_compare_exchange_n( &slot->sequence, &sequence, sequence + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) ) {
+            break;
+        }
+        sched_yield();
+    }
+
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    if( event_object.sequence > slot->event_object.sequence ) {
+        slot->event_object = event_object;
+    }
+    __atomic_store_n( &slot->sequence, sequence + 2, __ATOMIC_RELEASE );
+}
+
+// read last event sent with event_id (events_table last_value), lock free, return 0 if not available
+int get_last_value( event_id_t event_id, event_object_t *event_object )
+{
+    last_value_slot_t   *slot;
+    uint32_t            sequence;
+
+    if( ( event_id < 0 ) || ( event_id >= ev_max ) || !events_table[ event_id ].last_value ) {
+        return 0;
+    }
+
+    slot = &last_values[ event_id ];
+    do {
+        sequence = __atomic_load_n( &slot->sequence, __ATOMIC_ACQUIRE );
+        if( sequence == 0 ) {
+            return 0;
+        }
+        *event_object = slot->event_object;
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    } while( ( sequence & 1 ) || ( sequence != __atomic_load_n( &slot->sequence, __ATOMIC_RELAXED ) ) );
+
+    return 1;
+}
+
+// hand event to group listeners, delivered is set to the number of listeners' queues the event was copied into
+// return event_would_block if group's blocking ring is full (event is not sent at all)
+static event_send_status_t deliver_event( event_id_t event_id, uint32_t data, uint32_t origin_node, uint32_t *delivered )
+{
+    event_listener_node_t   *p;
+    events_group_t          group;
+    broadcast_ring_t        *ring = NULL;
+
+    *delivered = 0;
+    group = events_table[ event_id ].group;
+
+    // reserve ring slot first, an event refused by a full ring must not be sequenced nor cached
+    if( events_groups_table[ group ].dispatch != group_dispatch_queue ) {
+        ring = &group_rings[ group ];
+        pthread_mutex_lock( &ring->mutex );
+        if( !ring_has_room( group ) ) {
+            pthread_mutex_unlock( &ring->mutex );
+            return event_would_block;
+        }
+    }
 
-        group = events_table[ event_id ].group;
+    event_object_t  event_object;
+    event_object.id         = event_id;
+    event_object.timestamp  = current_timestamp_millis();
+    event_object.data       = data;
+    event_object.origin     = origin_node;
+    event_object.sequence   = __atomic_add_fetch( &event_sequence, 1, __ATOMIC_RELAXED );
 
-        event_object_t  event_object;
-        event_object.id         = event_id;
-        event_object.timestamp  = current_timestamp_millis();
-        event_object.data       = data;
+    // update last value before dispatching, a module subscribing meanwhile gets it either way
+    if( events_table[ event_id ].last_value ) {
+        store_last_value( event_object );
+    }
 
-        // signal event to all listeners interested in event's group
+    if( ring == NULL ) {
+        // signal event to all listeners interested in event's group (and in event's content)
         p = event_group_listeners[ group ];
         while( p != NULL ) {
-            dispatch_event( p->thread_data, event_object );
+            if( event_filter_accepts( p->thread_data, event_object ) ) {
+                *delivered += dispatch_event( p->thread_data, event_object );
+            }
             p = p->next;
         }
     } else {
+        // write event once, listeners read it from the group's ring
+        publish_event( group, event_object );
+        pthread_mutex_unlock( &ring->mutex );
+        ring_wake_listeners( group );
+    }
+
+    return event_sent;
+}
+
+// convert a wall clock timestamp in milliseconds for pthread_cond_timedwait
+static void millis_to_timespec( struct timespec *ts, int64_t milliseconds )
+{
+    ts->tv_sec  = milliseconds / 1000;
+    ts->tv_nsec = ( milliseconds % 1000 ) * 1000000;
+}
+
+// give back token and credits taken for an event refused by a full ring
+static void flow_refund( event_id_t event_id, uint32_t charged )
+{
+    events_group_t  group = events_table[ event_id ].group;
+    group_flow_t    *flow = &group_flows[ group ];
+    token_bucket_t  *bucket = &event_buckets[ event_id ];
+    uint64_t        capacity = token_bucket_capacity( event_id );
+
+    pthread_mutex_lock( &flow->mutex );
+    if( events_table[ event_id ].rate > 0 ) {
+        bucket->tokens = ( bucket->tokens + 1000 < capacity ) ? bucket->tokens + 1000 : capacity;
+    }
+    flow->would_block++;
+    pthread_mutex_unlock( &flow->mutex );
+
+    flow_release( group, charged );
+}
+
+// wait for room in group's broadcast ring up to deadline (wall clock, 0 = no deadline), return 0 if ring is still full
+static int ring_wait_room( events_group_t group, int64_t deadline )
+{
+    broadcast_ring_t    *ring = &group_rings[ group ];
+    struct timespec     ts;
+    int                 room;
+
+    pthread_mutex_lock( &ring->mutex );
+
+    // waiters is raised before checking cursors, listeners moving their cursor afterwards signal us
+    __atomic_add_fetch( &ring->waiters, 1, __ATOMIC_SEQ_CST );
+    while( !( room = ring_has_room( group ) ) ) {
+        if( deadline == 0 ) {
+            pthread_cond_wait( &ring->cond, &ring->mutex );
+        } else if( wall_clock_millis() < deadline ) {
+            millis_to_timespec( &ts, deadline );
+            pthread_cond_timedwait( &ring->cond, &ring->mutex, &ts );
+        } else {
+            break;
+        }
+    }
+    __atomic_sub_fetch( &ring->waiters, 1, __ATOMIC_SEQ_CST );
+
+    pthread_mutex_unlock( &ring->mutex );
+
+    return room;
+}
+
+// apply group's flow control, optionally waiting for credits / tokens / ring room, then send event
+static event_send_status_t send_event_flow( event_id_t event_id, uint32_t data, uint32_t origin_node, int wait, int32_t timeout_milliseconds )
+{
+    struct timespec         ts;
+    events_group_t          group;
+    group_flow_t            *flow;
+    event_send_status_t     status = event_sent;
+    uint32_t                charged;
+    uint32_t                delivered;
+    uint32_t                wait_ms;
+    int64_t                 now;
+    int64_t                 deadline;
+    int64_t                 wakeup;
+
+#ifdef EVENT_MANAGER_DEBUG
+    printf( "[ EVMNG ] Dispatching event %d\n", event_id );
+#endif
+
+    if( ( event_id < 0 ) || ( event_id >= ev_max ) ) {
 #ifdef EVENT_MANAGER_DEBUG
         printf( "[ EVMNG ] Wrong event id %d\n", event_id );
 #endif
+        return event_wrong_id;
+    }
+
+    group = events_table[ event_id ].group;
+    flow = &group_flows[ group ];
+
+    // with virtual clock a module's thread never waits, it would never get idle and time would stop
+    if( virtual_clock_enabled && ( current_thread_data != NULL ) ) {
+        wait = 0;
+    }
+
+    // producers wait on wall clock, tokens are earned on event manager time source
+    deadline = wall_clock_millis() + timeout_milliseconds;
+
+    while( 1 ) {
+
+        charged = 0;
+
+        // group's lock is taken only if event or group are flow controlled
+        if( ( events_groups_table[ group ].credits > 0 ) || ( events_table[ event_id ].rate > 0 ) ) {
+
+            pthread_mutex_lock( &flow->mutex );
+
+            now = wall_clock_millis();
+            while( ( status = flow_try_acquire( event_id, current_timestamp_millis(), &charged, &wait_ms ) ) != event_sent ) {
+
+                if( !wait || ( ( timeout_milliseconds > 0 ) && ( now >= deadline ) ) ) {
+                    break;
+                }
+
+                // virtual clock doesn't move while producer waits, tokens would never come
+                if( virtual_clock_enabled && ( status == event_rate_limited ) ) {
+                    break;
+                }
+
+                // wait for next token or for listeners to give credits back, never beyond deadline
+                flow->waiters++;
+                if( ( wait_ms > 0 ) || ( timeout_milliseconds > 0 ) ) {
+                    wakeup = ( wait_ms > 0 ) ? now + wait_ms : deadline;
+                    if( ( timeout_milliseconds > 0 ) && ( wakeup > deadline ) ) {
+                        wakeup = deadline;
+                    }
+                    millis_to_timespec( &ts, wakeup );
+                    pthread_cond_timedwait( &flow->cond, &flow->mutex, &ts );
+                } else {
+                    pthread_cond_wait( &flow->cond, &flow->mutex );
+                }
+                flow->waiters--;
+
+                now = wall_clock_millis();
+            }
+
+            if( status == event_would_block ) {
+                flow->would_block++;
+            } else if( status == event_rate_limited ) {
+                flow->rate_limited++;
+            }
+
+            pthread_mutex_unlock( &flow->mutex );
+
+            if( status != event_sent ) {
+#ifdef EVENT_MANAGER_DEBUG
+                printf( "[ EVMNG ] Event %d not sent, group %d flow control status %d\n", event_id, group, status );
+#endif
+                return status;
+            }
+        }
+
+        if( deliver_event( event_id, data, origin_node, &delivered ) == event_sent ) {
+            break;
+        }
+
+        // blocking ring is full, listeners are behind: give back what was taken and wait for room (if allowed)
+        flow_refund( event_id, charged );
+        if( !wait || !ring_wait_room( group, ( timeout_milliseconds > 0 ) ? deadline : 0 ) ) {
+#ifdef EVENT_MANAGER_DEBUG
+            printf( "[ EVMNG ] Event %d not sent, group %d ring is full\n", event_id, group );
+#endif
+            return event_would_block;
+        }
+    }
+
+    // copies filtered out or dropped at a full queue will never be dequeued, give their credits back
+    if( ( events_groups_table[ group ].dispatch == group_dispatch_queue ) && ( charged > delivered ) ) {
+        flow_release( group, charged - delivered );
+    }
+
+    return event_sent;
+}
+
+// send event to dispachter, never blocks (see events_groups_table credits / dispatch and events_table rate)
+event_send_status_t send_event( event_id_t event_id, uint32_t data )
+{
+    return send_event_flow( event_id, data, 0, 0, 0 );
+}
+
+// send event to dispachter waiting up to timeout_milliseconds for credits / tokens / ring room (0 = wait indefinitely)
+event_send_status_t send_event_wait( event_id_t event_id, uint32_t data, int32_t timeout_milliseconds )
+{
+    return send_event_flow( event_id, data, 0, 1, timeout_milliseconds );
+}
+
+// re-inject event received from another node (used by bridges) waiting up to timeout_milliseconds for credits / tokens / ring room (0 = wait indefinitely, < 0 = don't wait)
+event_send_status_t send_event_from_node( event_id_t event_id, uint32_t data, uint32_t origin_node, int32_t timeout_milliseconds )
+{
+    return send_event_flow( event_id, data, origin_node, ( timeout_milliseconds >= 0 ), timeout_milliseconds );
+}
+
+// start a resumable task from a handler of the calling module, runs it until first EVENT_TASK_AWAIT
+int event_task_start( event_task_t *task, event_task_fn_t fn, void *ctx )
+{
+    // a suspended task can't be restarted until it's resumed
+    if( task->waiting ) {
+#ifdef EVENT_MANAGER_DEBUG
+        printf( "[ EVMNG ] Error. Task %p already waiting\n", task );
+#endif
+        return EVENT_TASK_WAITING;
+    }
+
+    task->resume_point      = 0;
+    task->event_object.id   = -1;
+    task->fn                = fn;
+    task->ctx               = ctx;
+
+    return fn( task, ctx );
+}
+
+// suspend task on calling module's thread (use EVENT_TASK_AWAIT instead), return 0 if task can't wait (id EVENT_TASK_FAILED)
+int event_task_await( event_task_t *task, event_id_t event_id, int match_data, uint32_t data, int32_t timeout_milliseconds )
+{
+    thread_data_t   *thread_data = current_thread_data;
+    event_await_t   *await;
+
+    // replaced by the resuming event (or timeout) once suspended
+    task->event_object.id = EVENT_TASK_FAILED;
+
+    if( ( thread_data == NULL ) || ( event_id < 0 ) || ( event_id >= ev_max ) ) {
+#ifdef EVENT_MANAGER_DEBUG
+        printf( "[ EVMNG ] Error. Task %p can't wait for event %d\n", task, event_id );
+#endif
+        return 0;
+    }
+
+    // reuse wait nodes, malloc only when thread has more tasks waiting than ever before
+    if( thread_data->free_awaits != NULL ) {
+        await = thread_data->free_awaits;
+        thread_data->free_awaits = await->next;
+    } else {
+        await = ( event_await_t * ) malloc( sizeof( event_await_t ) );
+        if( await == NULL ) {
+            return 0;
+        }
+    }
+
+    await->task         = task;
+    await->match_data   = match_data;
+    await->data         = data;
+    await->deadline     = 0;
+    if( timeout_milliseconds > 0 ) {
+        await->deadline = current_timestamp_millis() + timeout_milliseconds;
+        if( ( thread_data->next_await_deadline == 0 ) || ( await->deadline < thread_data->next_await_deadline ) ) {
+            thread_data->next_await_deadline = await->deadline;
+        }
+    }
+
+    // newest first, resume_awaiting_tasks restores waiting order
+    await->next = thread_data->awaits[ event_id ];
+    thread_data->awaits[ event_id ] = await;
+    task->waiting = 1;
+
+    return 1;
+}
+
+// run tasks of a detached list (oldest first) and recycle their wait nodes
+static void resume_tasks( thread_data_t *thread_data, event_await_t *resumed, event_object_t event_object )
+{
+    event_await_t   *await;
+    event_task_t    *task;
+
+    while( resumed != NULL ) {
+        await = resumed;
+        resumed = resumed->next;
+
+        task = await->task;
+        await->next = thread_data->free_awaits;
+        thread_data->free_awaits = await;
+
+        // task can wait again (or be released) inside its function
+        task->waiting       = 0;
+        task->event_object  = event_object;
+        task->fn( task, task->ctx );
+    }
+}
+
+// resume tasks waiting for the event just dequeued, return 0 if nobody was waiting for it
+static int resume_awaiting_tasks( thread_data_t *thread_data, event_object_t event_object )
+{
+    event_await_t   **pp;
+    event_await_t   *await;
+    event_await_t   *resumed = NULL;
+
+    // detach matching nodes first, resumed tasks may wait for the same event again
+    pp = &thread_data->awaits[ event_object.id ];
+    while( *pp != NULL ) {
+        await = *pp;
+        if( !await->match_data || ( await->data == event_object.data ) ) {
+            *pp = await->next;
+            await->next = resumed;
+            resumed = await;
+        } else {
+            pp = &await->next;
+        }
+    }
+
+    if( resumed == NULL ) {
+        return 0;
+    }
+
+    resume_tasks( thread_data, resumed, event_object );
+    return 1;
+}
+
+// resume tasks whose wait timed out
+static void expire_awaiting_tasks( thread_data_t *thread_data, int64_t now )
+{
+    event_await_t   **pp;
+    event_await_t   *await;
+    event_await_t   *resumed = NULL;
+    event_object_t  timeout_object = { .id = EVENT_TASK_TIMEOUT };
+    int i;
+
+    if( ( thread_data->next_await_deadline == 0 ) || ( now < thread_data->next_await_deadline ) ) {
+        return;
+    }
+
+    // collect expired waits and find the next deadline among the others
+    thread_data->next_await_deadline = 0;
+    for( i = 0; i < ev_max; i++ ) {
+        pp = &thread_data->awaits[ i ];
+        while( *pp != NULL ) {
+            await = *pp;
+            if( ( await->deadline != 0 ) && ( await->deadline <= now ) ) {
+                *pp = await->next;
+                await->next = resumed;
+                resumed = await;
+            } else {
+                if( ( await->deadline != 0 ) &&
+                    ( ( thread_data->next_await_deadline == 0 ) || ( await->deadline < thread_data->next_await_deadline ) ) ) {
+                    thread_data->next_await_deadline = await->deadline;
+                }
+                pp = &await->next;
+            }
+        }
+    }
+
+    timeout_object.timestamp = now;
+    resume_tasks( thread_data, resumed, timeout_object );
+}
+
+// release wait nodes when thread terminates, tasks still waiting are never resumed
+static void release_awaiting_tasks( thread_data_t *thread_data )
+{
+    event_await_t   *await;
+    int i;
+
+    for( i = 0; i < ev_max; i++ ) {
+        while( thread_data->awaits[ i ] != NULL ) {
+            await = thread_data->awaits[ i ];
+            thread_data->awaits[ i ] = await->next;
+            free( await );
+        }
+    }
+    while( thread_data->free_awaits != NULL ) {
+        await = thread_data->free_awaits;
+        thread_data->free_awaits = await->next;
+        free( await );
     }
 }
 
@@ -223,6 +1205,213 @@ static void get_wait_time( struct timespec *ts, int milliseconds_timeout )
     }
 }
 
+// restart token buckets refill from current time of (new) time source
+static void reset_token_buckets()
+{
+    group_flow_t    *flow;
+    int i;
+
+    for( i = 0; i < ev_max; i++ ) {
+        flow = &group_flows[ events_table[ i ].group ];
+        pthread_mutex_lock( &flow->mutex );
+        event_buckets[ i ].last_refill = current_timestamp_millis();
+        pthread_mutex_unlock( &flow->mutex );
+    }
+}
+
+// replace wall clock with a custom time source (NULL restores wall clock), call before starting threads
+void set_event_time_source( event_time_source_t time_source )
+{
+    event_time_source = time_source;
+    reset_token_buckets();
+}
+
+// current time of event manager in milliseconds
+int64_t get_event_time_millis()
+{
+    return current_timestamp_millis();
+}
+
+// switch to a deterministic virtual clock starting at start_millis, call before starting threads
+void enable_virtual_clock( int64_t start_millis )
+{
+    __atomic_store_n( &virtual_clock_now, start_millis, __ATOMIC_SEQ_CST );
+    virtual_clock_enabled = 1;
+    reset_token_buckets();
+}
+
+// wait until woken by an event or by virtual clock reaching timeout (thread mutex must be locked)
+static void wait_virtual_clock( thread_data_t *thread_data, int32_t wait_milliseconds )
+{
+    thread_data->wakeup_deadline = 0;
+    if( wait_milliseconds > 0 ) {
+        thread_data->wakeup_deadline = current_timestamp_millis() + wait_milliseconds;
+    }
+
+    // idle is cleared by whoever hands an event to the thread or by advance_virtual_clock
+    thread_data->idle = 1;
+    while( thread_data->idle ) {
+        pthread_cond_wait( &thread_data->cond, &thread_data->mutex );
+    }
+    thread_data->wakeup_deadline = 0;
+}
+
+// add / remove thread to the list driven by virtual clock
+static void register_event_thread( thread_data_t *thread_data, int registered )
+{
+    event_listener_node_t   **pp;
+    event_listener_node_t   *p;
+
+    pthread_mutex_lock( &event_threads_mutex );
+    if( registered ) {
+        p = ( event_listener_node_t * ) malloc( sizeof( event_listener_node_t ) );
+        p->thread_data = thread_data;
+        p->next = event_threads;
+        event_threads = p;
+        event_threads_count++;
+        pthread_cond_broadcast( &event_threads_cond );
+    } else {
+        for( pp = &event_threads; *pp != NULL; pp = &( *pp )->next ) {
+            if( ( *pp )->thread_data == thread_data ) {
+                p = *pp;
+                *pp = p->next;
+                free( p );
+                event_threads_count--;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock( &event_threads_mutex );
+}
+
+// wait until at least "threads" event processing threads are subscribed to their groups
+void wait_event_threads_ready( uint32_t threads )
+{
+    pthread_mutex_lock( &event_threads_mutex );
+    while( event_threads_count < threads ) {
+        pthread_cond_wait( &event_threads_cond, &event_threads_mutex );
+    }
+    pthread_mutex_unlock( &event_threads_mutex );
+}
+
+// virtual clock: wait until every event processing thread has nothing left to do
+void run_virtual_clock_until_idle()
+{
+    event_listener_node_t   *p;
+    uint64_t                activity;
+    uint32_t                busy_thread = 0;
+    int64_t                 stall_deadline = wall_clock_millis() + VIRTUAL_CLOCK_STALL_MILLISECONDS;
+    int                     idle;
+
+    // all threads idle and no event handed to any of them while checking = nothing left to do
+    do {
+        sched_yield();
+        activity = __atomic_load_n( &virtual_clock_activity, __ATOMIC_SEQ_CST );
+        idle = 1;
+        pthread_mutex_lock( &event_threads_mutex );
+        for( p = event_threads; ( p != NULL ) && idle; p = p->next ) {
+            pthread_mutex_lock( &p->thread_data->mutex );
+            idle = p->thread_data->idle;
+            busy_thread = p->thread_data->thread_id;
+            pthread_mutex_unlock( &p->thread_data->mutex );
+        }
+        pthread_mutex_unlock( &event_threads_mutex );
+
+        // a thread blocked outside event manager never gets idle, tell why time doesn't move (once)
+        if( !idle && ( stall_deadline != 0 ) && ( wall_clock_millis() >= stall_deadline ) ) {
+            printf( "[ EVMNG ] Warning. Virtual clock stalled, thread %d busy for more than %d ms (blocked outside event manager?)\n",
+                    busy_thread, VIRTUAL_CLOCK_STALL_MILLISECONDS );
+            stall_deadline = 0;
+        }
+    } while( !idle || ( activity != __atomic_load_n( &virtual_clock_activity, __ATOMIC_SEQ_CST ) ) );
+}
+
+// virtual clock: earliest timeout of idle threads (0 = none), optionally waking up threads already due
+static int64_t virtual_clock_next_deadline( int wake_due )
+{
+    event_listener_node_t   *p;
+    thread_data_t           *thread_data;
+    int64_t                 now = current_timestamp_millis();
+    int64_t                 next = 0;
+
+    pthread_mutex_lock( &event_threads_mutex );
+    for( p = event_threads; p != NULL; p = p->next ) {
+        thread_data = p->thread_data;
+        pthread_mutex_lock( &thread_data->mutex );
+        if( thread_data->idle && ( thread_data->wakeup_deadline != 0 ) ) {
+            if( wake_due && ( thread_data->wakeup_deadline <= now ) ) {
+                thread_data->idle = 0;
+                pthread_cond_signal( &thread_data->cond );
+            } else if( ( next == 0 ) || ( thread_data->wakeup_deadline < next ) ) {
+                next = thread_data->wakeup_deadline;
+            }
+        }
+        pthread_mutex_unlock( &thread_data->mutex );
+    }
+    pthread_mutex_unlock( &event_threads_mutex );
+
+    return next;
+}
+
+// virtual clock: move time forward running all timed work and queued events due meanwhile
+void advance_virtual_clock( int64_t milliseconds )
+{
+    int64_t target = current_timestamp_millis() + milliseconds;
+    int64_t next;
+
+    if( !virtual_clock_enabled ) {
+        return;
+    }
+
+    // jump from a timeout to the next one, each step runs to quiescence before time moves again
+    run_virtual_clock_until_idle();
+    while( ( ( next = virtual_clock_next_deadline( 0 ) ) != 0 ) && ( next <= target ) ) {
+        __atomic_store_n( &virtual_clock_now, next, __ATOMIC_SEQ_CST );
+        virtual_clock_next_deadline( 1 );
+        run_virtual_clock_until_idle();
+    }
+    __atomic_store_n( &virtual_clock_now, target, __ATOMIC_SEQ_CST );
+}
+
+// search and call the appropriate event handler
+static void call_event_handler( thread_ctrl_t *thread_ctrl, event_object_t event_object )
+{
+    int i;
+
+    // NOTE in case of bigger arrays search operation should be improved with hash table
+    for( i = 0; i < thread_ctrl->max_event_handlers; i++ ) {
+        if( event_object.id == thread_ctrl->handlers[ i ].event_id ) {
+            thread_ctrl->handlers[ i ].handler( event_object );
+            break;
+        }
+    }
+}
+
+// hand last values of subscribed groups to a module that just subscribed
+// handlers are called before any queued event, so a newer event can't be overwritten by a cached one.
+// an event sent while subscribing can be both cached and queued, its sequence is kept to skip the queued copy
+static void deliver_last_values( thread_data_t *thread_data, thread_ctrl_t *thread_ctrl )
+{
+    event_object_t  event_object;
+    int             event_id;
+    uint32_t i;
+
+    for( i = 0; i < thread_ctrl->max_groups; i++ ) {
+        for( event_id = 0; event_id < ev_max; event_id++ ) {
+            if( ( events_table[ event_id ].group == thread_ctrl->groups[ i ] ) &&
+                ( event_id != ev_terminate_thread ) &&
+                get_last_value( event_id, &event_object ) &&
+                event_filter_accepts( thread_data, event_object ) ) {
+#ifdef EVENT_MANAGER_DEBUG
+                printf("[ EPT %d ] Last value event id: %2d data %d\n", thread_data->thread_id, event_object.id, event_object.data );
+#endif
+                thread_data->last_value_sequence[ event_id ] = event_object.sequence;
+                call_event_handler( thread_ctrl, event_object );
+            }
+        }
+    }
+}
+
 // base event processing thread customizable using thread_ctrl_t structure
 void* event_processing_thread( void *arg )
 {
@@ -230,6 +1419,8 @@ void* event_processing_thread( void *arg )
     thread_data_t       thread_data;
     event_object_t      event_object;
     thread_ctrl_t       *thread_ctrl = ( thread_ctrl_t* ) arg;
+    int32_t             wait_milliseconds;
+    int64_t             remaining;
     int i;
 
 #ifdef EVENT_MANAGER_DEBUG
@@ -247,12 +1438,33 @@ void* event_processing_thread( void *arg )
     initialize_thread_event_queue( &thread_data.queue );
     pthread_mutex_init( &thread_data.mutex, NULL );
     pthread_cond_init( &thread_data.cond, NULL );
+    memset( thread_data.ring_cursor, 0, sizeof( thread_data.ring_cursor ) );
+    thread_data.ring_overruns = 0;
+    thread_data.parked = 0;
+    memset( thread_data.awaits, 0, sizeof( thread_data.awaits ) );
+    thread_data.free_awaits = NULL;
+    thread_data.next_await_deadline = 0;
+    thread_data.idle = 0;
+    thread_data.wakeup_deadline = 0;
+    memset( thread_data.last_value_sequence, 0, sizeof( thread_data.last_value_sequence ) );
+
+    // allow handlers running on this thread to suspend tasks
+    current_thread_data = &thread_data;
+
+    // filters must be ready before subscribing, producers check them as soon as we are listed
+    compile_event_filters( &thread_data, thread_ctrl );
 
     // register for event groups
     for( i = 0; i < thread_ctrl->max_groups; i++ ) {
         subscribe_for_events_group( &thread_data, thread_ctrl->groups[ i ] );
     }
 
+    // let virtual clock know this thread
+    register_event_thread( &thread_data, 1 );
+
+    // catch up with state events sent before subscription (last values are read once listed, nothing is missed)
+    deliver_last_values( &thread_data, thread_ctrl );
+
 #ifdef EVENT_MANAGER_DEBUG
     printf("[ EPT %d ] Initialization complete thread data @ %p\n", thread_data.thread_id, &thread_data );
 #endif
@@ -266,23 +1478,48 @@ void* event_processing_thread( void *arg )
         // check if event queue is empty
         if( queue_is_empty( &thread_data.queue ) ) {
 
+            // ring producers signal only parked threads, so flag it before checking rings
+            __atomic_store_n( &thread_data.parked, 1, __ATOMIC_SEQ_CST );
+        }
+
+        // wait only if there is nothing to read from broadcast rings either
+        if( queue_is_empty( &thread_data.queue ) && !ring_is_pending( &thread_data, thread_ctrl ) ) {
+
             // commented out to not messing up log
             // printf("[ EPT %d ] Waiting for event...\n", thread_data.thread_id );
 
-            // if a wait timeout is specified...
-            if( thread_ctrl->timedwait_milliseconds > 0 ) {
+            // wake up for timed operations or for the first waiting task to time out, whichever comes first
+            wait_milliseconds = thread_ctrl->timedwait_milliseconds;
+            remaining = 1;
+            if( thread_data.next_await_deadline != 0 ) {
+                remaining = thread_data.next_await_deadline - current_timestamp_millis();
+                if( remaining > INT32_MAX ) {
+                    remaining = INT32_MAX;
+                }
+                if( ( wait_milliseconds <= 0 ) || ( remaining < wait_milliseconds ) ) {
+                    wait_milliseconds = ( int32_t ) remaining;
+                }
+            }
+
+            if( remaining <= 0 ) {
+                // a waiting task already timed out, don't wait at all
+            } else if( virtual_clock_enabled ) {
+                // wait until an event arrives or virtual clock reaches the timeout
+                wait_virtual_clock( &thread_data, wait_milliseconds );
+            } else if( wait_milliseconds > 0 ) {
                 // wait for an event to be available until timeout expires
                 clock_gettime(CLOCK_REALTIME, &ts);
-                get_wait_time( &ts, thread_ctrl->timedwait_milliseconds );
+                get_wait_time( &ts, wait_milliseconds );
                 pthread_cond_timedwait( &thread_data.cond, &thread_data.mutex, &ts );
             } else {
                 // wait indefinitely for an event to be available
                 pthread_cond_wait( &thread_data.cond, &thread_data.mutex );
             }
         }
+        __atomic_store_n( &thread_data.parked, 0, __ATOMIC_SEQ_CST );
 
-        // dequeue an event
-        event_object = dequeue_event( &thread_data.queue );
+        // dequeue the oldest event, whether it was dispatched through private queue or broadcast rings
+        event_object = dequeue_oldest_event( &thread_data, thread_ctrl );
 
 #ifdef EVENT_MANAGER_DEBUG
         printf("[ EPT %d ] Dequeued event id: %2d data %-012d timestamp %lld\n", thread_data.thread_id, event_object.id, event_object.data, event_object.timestamp ); // Print statement for debugging
@@ -296,23 +1533,27 @@ void* event_processing_thread( void *arg )
         }
 
         // if event_object.id == -1 it may be a timed wait task
-        if( ( event_object.id >= 0 ) && ( event_object.id < ev_max ) ) {
+        // events already handed as last values at subscription are skipped (same or older sequence)
+        // events awaited by suspended tasks resume them instead of reaching the handlers
+        if( ( event_object.id >= 0 ) && ( event_object.id < ev_max ) &&
+            ( event_object.sequence > thread_data.last_value_sequence[ event_object.id ] ) &&
+            !resume_awaiting_tasks( &thread_data, event_object ) ) {
             // search and call the appropriate event handler
-            // NOTE in case of bigger arrays search operation should be improved with hash table
-            for( i = 0; i < thread_ctrl->max_event_handlers; i++ ) {
-                if( event_object.id == thread_ctrl->handlers[ i ].event_id ) {
-                    thread_ctrl->handlers[ i ].handler( event_object );
-                    break;
-                }
-            }
+            call_event_handler( thread_ctrl, event_object );
         }
 
+        // resume tasks whose wait timed out (if any)
+        expire_awaiting_tasks( &thread_data, current_timestamp_millis() );
+
         // perform timed operations (if needed)
         if( thread_ctrl->timed_ops != NULL ) {
             thread_ctrl->timed_ops();
         }
     }
 
+    release_awaiting_tasks( &thread_data );
+    register_event_thread( &thread_data, 0 );
+
 #ifdef EVENT_MANAGER_DEBUG
     printf("[ EPT %d ] Thread terminated\n", thread_data.thread_id );
 #endif
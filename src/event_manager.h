@@ -28,6 +28,12 @@
 // thread's event queue size
 #define THREAD_EVENT_QUEUE_SIZE       64
 
+// shared broadcast ring size for groups not using group_dispatch_queue (must be a power of 2)
+#define GROUP_BROADCAST_RING_SIZE     256
+
+// virtual clock: wall time a thread can stay busy before a stall warning
+#define VIRTUAL_CLOCK_STALL_MILLISECONDS    5000
+
 
 
 // define event structure
@@ -35,6 +41,8 @@ typedef struct {
     int             id;             // unique identifier value of event
     uint32_t        data;           // extra data (if any)
     uint64_t        timestamp;      // timestamp in milliseconds when event is signaled
+    uint32_t        origin;         // node the event was sent from through a bridge (0 = this node)
+    uint64_t        sequence;       // dispatch order, events of all groups are handled in this order
 } event_object_t;
 
 // thread's event queue data
@@ -44,14 +52,134 @@ typedef struct {
     int             rear;
 } event_queue;
 
+// subscription filter kinds
+typedef enum {
+    filter_predicate,           // accept when predicate( event_object ) returns non zero
+    filter_mask,                // accept when ( data & mask ) == value
+    filter_range,               // accept when min <= data <= max
+    filter_set                  // accept when data is one of values[ 0 .. max_values - 1 ]
+} event_filter_type_t;
+
+/*
+    content filter attached to a module subscription
+
+    filters are evaluated by the producer inside send_event, so an event discarded by the
+    filter is never enqueued and never wakes the module's thread up.
+    exception: groups dispatched through a broadcast ring share one copy of the event among all
+    listeners, so filters are evaluated by the module's thread when reading the ring. a filtered
+    out event can wake the thread up (handlers are not called), the thread must still read past
+    it to give ring slots and credits back.
+    at most one filter per event id is considered, events without a filter are always delivered.
+    for filter_set the values array is sorted in place when the thread starts so that every
+    check is a binary search.
+    hits / misses are updated by producers and can be read at any time for statistics
+*/
+typedef struct {
+    event_id_t          event_id;                   // event the filter applies to
+    event_filter_type_t type;                       // how data is checked
+    int                 ( *predicate )( event_object_t );   // filter_predicate callback
+    uint32_t            mask;                       // filter_mask
+    uint32_t            value;                      // filter_mask
+    uint32_t            min;                        // filter_range lower bound (included)
+    uint32_t            max;                        // filter_range upper bound (included)
+    uint32_t            *values;                    // filter_set values
+    uint32_t            max_values;                 // filter_set number of values
+    uint64_t            hits;                       // events delivered to the module
+    uint64_t            misses;                     // events discarded before dispatch
+} event_filter_t;
+
+/*
+    resumable (stackless) task
+
+    a handler can start a task that suspends itself waiting for a follow-up event, the module's
+    thread keeps processing other events and resumes the task inline when the awaited event is
+    dequeued (or when the wait times out, task->event_object.id is -1 in that case).
+    the awaited event is consumed by the waiting tasks and is not passed to module's handlers,
+    it must belong to a group the module is subscribed to.
+    a task costs only its own structure and a small wait node while suspended, so a thread can
+    keep thousands of them in flight.
+    task function is written between EVENT_TASK_BEGIN / EVENT_TASK_END and suspends with
+    EVENT_TASK_AWAIT, local variables are NOT preserved across EVENT_TASK_AWAIT (keep state in ctx).
+    task and ctx memory belong to the module and can be released once the task is done
+*/
+typedef struct event_task event_task_t;
+
+// task body, returns EVENT_TASK_WAITING or EVENT_TASK_DONE
+typedef int ( *event_task_fn_t )( event_task_t *task, void *ctx );
+
+struct event_task {
+    int                 resume_point;   // where task continues (0 = start)
+    int                 waiting;        // task is suspended waiting for an event
+    event_object_t      event_object;   // event that resumed the task (id EVENT_TASK_TIMEOUT / EVENT_TASK_FAILED)
+    event_task_fn_t     fn;             // task body
+    void                *ctx;           // task state
+};
+
+#define EVENT_TASK_WAITING              0
+#define EVENT_TASK_DONE                 1
+
+// event_object.id after EVENT_TASK_AWAIT when no event resumed the task
+#define EVENT_TASK_TIMEOUT              ( -1 )      // timeout expired
+#define EVENT_TASK_FAILED               ( -2 )      // task couldn't wait (wrong event id, not on a module's thread, no memory)
+
+// EVENT_TASK_AWAIT falls through to its resume point on purpose (-Wimplicit-fallthrough)
+#if defined( __has_attribute )
+#if __has_attribute( fallthrough )
+#define EVENT_TASK_FALLTHROUGH          __attribute__(( fallthrough ))
+#endif
+#endif
+#ifndef EVENT_TASK_FALLTHROUGH
+#define EVENT_TASK_FALLTHROUGH
+#endif
+
+#define EVENT_TASK_BEGIN( task )        switch( ( task )->resume_point ) { case 0:
+
+// suspend task until event_id (with given data if match_data) is dequeued or timeout expires (0 = no timeout)
+// if the task can't wait it goes on immediately with event_object.id EVENT_TASK_FAILED
+#define EVENT_TASK_AWAIT( task, event_id, match_data, data, timeout_milliseconds )                          \
+    do {                                                                                                    \
+        ( task )->resume_point = __LINE__;                                                                  \
+        if( event_task_await( ( task ), ( event_id ), ( match_data ), ( data ), ( timeout_milliseconds ) ) ) {  \
+            return EVENT_TASK_WAITING;                                                                      \
+        }                                                                                                   \
+        EVENT_TASK_FALLTHROUGH;                                                                             \
+        case __LINE__:;                                                                                     \
+    } while( 0 )
+
+#define EVENT_TASK_END( task )          } return EVENT_TASK_DONE
+
+// tasks waiting for an event (defined inside event manager)
+struct event_await;
+
 // thread's data
 typedef struct {
     uint32_t            thread_id;
     pthread_mutex_t     mutex;
     pthread_cond_t      cond;
     event_queue         queue;
+    event_filter_t      *filters[ ev_max ];     // filter for each event id (NULL = no filter)
+    uint64_t            ring_cursor[ events_group_max ];    // next sequence to read from each group's broadcast ring
+    uint64_t            ring_overruns;          // broadcast ring events overwritten before being read
+    int                 parked;                 // thread is waiting on cond, producers check it before signaling
+    struct event_await  *awaits[ ev_max ];      // tasks waiting for each event id
+    struct event_await  *free_awaits;           // wait nodes ready to be reused
+    int64_t             next_await_deadline;    // earliest timeout of waiting tasks (0 = none)
+    int                 idle;                   // virtual clock: thread waits with nothing left to do
+    int64_t             wakeup_deadline;        // virtual clock: time thread must be woken up at (0 = none)
+    uint64_t            last_value_sequence[ ev_max ];  // sequence of last values handed at subscription (0 = none)
 } thread_data_t;
 
+// send_event result
+typedef enum {
+    event_sent,                 // event handed to group listeners
+    event_would_block,          // event's group has no credits left, listeners are behind
+    event_rate_limited,         // event's token bucket is empty
+    event_wrong_id              // unknown event id
+} event_send_status_t;
+
+// time source returning current time in milliseconds
+typedef int64_t ( *event_time_source_t )( void );
+
 // event / handler relation structure
 typedef struct {
     event_id_t          event_id;
@@ -71,7 +199,11 @@ typedef struct {
     timedwait_milliseconds / timed_ops
     if you leave timedwait_milliseconds zero valued the thread wait indefinitely for events, else
     if you set a value in milliseconds the thread stop waiting events and can perform additional
-    operations through timed_ops callback
+    operations through timed_ops callback. it's read before every wait, so handlers and timed_ops
+    running on the thread can change it to adapt the period to their work
+    max_event_filters / filters
+    module can restrict the events it receives by content (see event_filter_t), leave them
+    0 / NULL to receive every event of the subscribed groups
 */
 typedef struct {
     uint32_t            module_id;                  // unique id
@@ -81,14 +213,74 @@ typedef struct {
     handler_t           *handlers;                  // pointer to array of handlers
     int32_t             timedwait_milliseconds;     // leave 0 to wait events indefinetely
     void                (*timed_ops)( void );       // callback called every "timedwait_milliseconds" ms
+    int32_t             max_event_filters;          // total number of filters
+    event_filter_t      *filters;                   // pointer to array of filters
 } thread_ctrl_t;
 
 
 // initialize event manager module
 void initialize_event_manager();
 
-// send event to dispachter
-void send_event( event_id_t event_id, uint32_t data );
+// send event to dispachter, never blocks (see events_groups_table credits / dispatch and events_table rate)
+event_send_status_t send_event( event_id_t event_id, uint32_t data );
+
+// send event to dispachter waiting up to timeout_milliseconds for credits / tokens / ring room (0 = wait indefinitely)
+event_send_status_t send_event_wait( event_id_t event_id, uint32_t data, int32_t timeout_milliseconds );
+
+// re-inject event received from another node (used by bridges) waiting up to timeout_milliseconds for credits / tokens / ring room (0 = wait indefinitely, < 0 = don't wait)
+event_send_status_t send_event_from_node( event_id_t event_id, uint32_t data, uint32_t origin_node, int32_t timeout_milliseconds );
+
+// read last event sent with event_id (events_table last_value), lock free, return 0 if not available
+int get_last_value( event_id_t event_id, event_object_t *event_object );
+
+// print flow control state and counters of each group
+void debug_event_groups_flow();
+
+// print hits / misses counters of module's filters
+void debug_event_filters( thread_ctrl_t *thread_ctrl );
+
+// start a resumable task from a handler of the calling module, runs it until first EVENT_TASK_AWAIT
+int event_task_start( event_task_t *task, event_task_fn_t fn, void *ctx );
+
+// suspend task on calling module's thread (use EVENT_TASK_AWAIT instead), return 0 if task can't wait (id EVENT_TASK_FAILED)
+int event_task_await( event_task_t *task, event_id_t event_id, int match_data, uint32_t data, int32_t timeout_milliseconds );
+
+/*
+    time source
+
+    event timestamps, timed operations, tasks timeouts and rate limits use event manager time,
+    by default wall clock. set_event_time_source replaces it with a custom source, while
+    enable_virtual_clock switches to a deterministic clock that moves only through
+    advance_virtual_clock: threads never time out by themselves, the driver jumps from a timeout
+    to the next one and lets every thread run to quiescence before moving time again, so long
+    periods of timed behaviour replay in a fraction of the time.
+    threads are started asynchronously, call wait_event_threads_ready before the first send or
+    advance, so that events and time reach every module.
+    with virtual clock producers should send events from the driving thread between advances,
+    send_event_wait doesn't wait for tokens (virtual time doesn't move while waiting) and, called
+    from a module's thread, doesn't wait at all (returns like send_event).
+    handlers and timed_ops must not block outside the event manager (sleeps, sockets, bridges are
+    not supported): a thread that never gets idle stops the virtual clock, run_virtual_clock_until_idle
+    prints a warning when it waits longer than VIRTUAL_CLOCK_STALL_MILLISECONDS.
+*/
+
+// replace wall clock with a custom time source (NULL restores wall clock), call before starting threads
+void set_event_time_source( event_time_source_t time_source );
+
+// current time of event manager in milliseconds
+int64_t get_event_time_millis();
+
+// switch to a deterministic virtual clock starting at start_millis, call before starting threads
+void enable_virtual_clock( int64_t start_millis );
+
+// virtual clock: move time forward running all timed work and queued events due meanwhile
+void advance_virtual_clock( int64_t milliseconds );
+
+// virtual clock: wait until every event processing thread has nothing left to do
+void run_virtual_clock_until_idle();
+
+// wait until at least "threads" event processing threads are subscribed to their groups
+void wait_event_threads_ready( uint32_t threads );
 
 // base event processing thread (you can define your custom thread but this is the base)
 void* event_processing_thread( void *arg );
@@ -18,14 +18,31 @@
 
 // events data
 // NOTE be careful to keep events_group_t and event_id_t consistent with this table
+// NOTE rate / burst define a token bucket for producers of the event, 0 rate means no limit
+// NOTE last value is meant for state events: a module subscribing late receives the last one sent
 events_table_item_t     events_table[ ev_max ] = {
-    //  event id                            group                       description
-    {   ev_terminate_thread,                events_group_threads,       "Thread termination"        },
-    {   ev_event1,                          events_group_1,             "Event 1"                   },
-    {   ev_event2,                          events_group_1,             "Event 2"                   },
-    {   ev_event3,                          events_group_2,             "Event 3"                   },
-    {   ev_event4,                          events_group_2,             "Event 4"                   },
-    {   ev_event5,                          events_group_3,             "Event 5"                   },
-    {   ev_event6,                          events_group_3,             "Event 6"                   },
+    //  event id                            group                       rate    burst   last    description
+    {   ev_terminate_thread,                events_group_threads,       0,      0,      0,      "Thread termination"        },
+    {   ev_event1,                          events_group_1,             0,      0,      0,      "Event 1"                   },
+    {   ev_event2,                          events_group_1,             0,      0,      0,      "Event 2"                   },
+    {   ev_event3,                          events_group_2,             0,      0,      1,      "Event 3"                   },
+    {   ev_event4,                          events_group_2,             0,      0,      0,      "Event 4"                   },
+    {   ev_event5,                          events_group_3,             100,    10,     0,      "Event 5"                   },
+    {   ev_event6,                          events_group_3,             0,      0,      0,      "Event 6"                   },
+    // ...
+};
+
+// groups data
+// NOTE be careful to keep events_group_t consistent with this table
+// NOTE group_dispatch_ring_* pays off for groups with many listeners: producer writes the event
+//      once instead of locking and copying into every listener's queue
+// NOTE credits limit the event copies a group can have waiting in listeners' queues / rings,
+//      producers of a group without credits left are refused (or wait) without affecting other groups
+events_group_item_t     events_groups_table[ events_group_max ] = {
+    //  group id                            dispatch                    credits description
+    {   events_group_threads,               group_dispatch_queue,       0,      "Threads control"           },
+    {   events_group_1,                     group_dispatch_ring_block,  0,      "Group 1"                   },
+    {   events_group_2,                     group_dispatch_queue,       32,     "Group 2"                   },
+    {   events_group_3,                     group_dispatch_queue,       0,      "Group 3"                   },
     // ...
 };
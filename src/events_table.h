@@ -17,6 +17,8 @@
 #ifndef EVENTS_TABLE_H_INCLUDED
 #define EVENTS_TABLE_H_INCLUDED
 
+#include <stdint.h>
+
 // define events
 typedef enum {
     ev_terminate_thread,
@@ -40,10 +42,28 @@ typedef enum {
     events_group_max
 } events_group_t;
 
+// define how events of a group reach listeners
+typedef enum {
+    group_dispatch_queue,           // event is copied into each listener's queue
+    group_dispatch_ring_block,      // event is written once into a shared ring, refused (event_would_block) while slowest listener is a ring behind
+    group_dispatch_ring_drop        // event is written once into a shared ring, slowest listener loses overwritten events
+} group_dispatch_t;
+
+// define group info
+typedef struct {
+    events_group_t      id;             // don't use this for group data search, only for clarity in table definition
+    group_dispatch_t    dispatch;       // how events are delivered to group listeners
+    uint32_t            credits;        // max event copies sent and not yet dequeued by listeners (0 = unlimited)
+    char                *description;   // for event log, debug, ...
+} events_group_item_t;
+
 // define event info
 typedef struct {
     event_id_t          id;             // don't use this for event data search, only for clarity in table definition
     events_group_t      group;          // group event belongs to
+    uint32_t            rate;           // max events per second sent by producers (0 = unlimited)
+    uint32_t            burst;          // events that can be sent at once when rate limited
+    uint32_t            last_value;     // keep last event sent for late subscribers and direct reads (0 = no)
     char                *description;   // for event log, debug, ...
     // ... other data type relating to specific event ...
 } events_table_item_t;
@@ -51,4 +71,7 @@ typedef struct {
 // export events data
 extern events_table_item_t     events_table[ ev_max ];
 
+// export groups data
+extern events_group_item_t     events_groups_table[ events_group_max ];
+
 #endif // EVENTS_TABLE_H_INCLUDED
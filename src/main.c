@@ -6,6 +6,7 @@
 #include "event_manager.h"
 #include "events_table.h"
 #include "consumer1.h"
+#include "bridge_loopback.h"
 
 // send event and data (if needed) to dispatcher
 void broadcast_event( int event_id, int data )
@@ -24,6 +25,9 @@ int main( int argc, char *argv[] ) {
     initialize_consumer2();
     initialize_consumer3();
 
+    // forward events_group_3 to this same process through TCP and unix socket bridges
+    initialize_bridge_loopback();
+
     // wait all threads are ready
     sleep( 1 );
 
@@ -39,14 +43,30 @@ int main( int argc, char *argv[] ) {
     broadcast_event( ev_event1, 123 );
     sleep( 1 );
 
+    // event2 (belongs to events_group_1) resumes consumer 1 task started by event1 instead of its handler
+    broadcast_event( ev_event2, 124 );
+    sleep( 1 );
+
     // event3 (belongs to events_group_2) should be dispatched to consumer 1 and 2
     broadcast_event( ev_event3, 456 );
     sleep( 1 );
 
-    // event5 (belongs to events_group_3) should be dispatched to consumer 3 only
+    // event4 (belongs to events_group_2) should be dispatched to consumer 1 only, consumer 2 filters data 15 out
+    broadcast_event( ev_event4, 15 );
+    sleep( 1 );
+
+    // event5 (belongs to events_group_3) should be dispatched to consumer 3 only, directly and through both bridges
     broadcast_event( ev_event5, 789 );
     sleep( 1 );
 
+    // bridge links notice servers going away and reconnect
+    restart_bridge_loopback_servers();
+    sleep( 1 );
+
+    // event6 (belongs to events_group_3) reaches consumer 3 through the reconnected bridges too
+    broadcast_event( ev_event6, 1011 );
+    sleep( 1 );
+
     printf( "\n\n\t Gently terminating...\n\n\n" );
 
     // terminating all thread subscribed for events_group_threads group
@@ -55,6 +75,7 @@ int main( int argc, char *argv[] ) {
     terminate_consumer1();
     terminate_consumer2();
     terminate_consumer3();
+    terminate_bridge_loopback();
 
     return 0;
 }